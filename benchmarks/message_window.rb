@@ -0,0 +1,72 @@
+# Message window text benchmark (Bitmap#draw_text)
+#
+# Redraws a four line message one character per draw_text
+# call every frame, the way message window scripts lay out
+# text, and times the drawing.
+#
+# Run mkxp with
+#   customScript=/path/to/message_window.rb
+#   headless=true
+# once with textCacheSize=0 (no text cache) and once with
+# the default. benchmarkReport=report.json adds per-phase
+# frame timings.
+#
+# Results are appended to bench_message_window.txt.
+
+FRAMES = 600
+LINES = [
+  "The quick brown fox jumps over the lazy",
+  "dog, then turns around and asks whether",
+  "anyone saw that. Nobody answers, so it",
+  "jumps again, just to be sure.",
+]
+
+def now
+  Process.clock_gettime(Process::CLOCK_MONOTONIC)
+end
+
+skin = Bitmap.new(128, 128)
+skin.fill_rect(0, 0, 128, 128, Color.new(32, 48, 96))
+
+window = Window.new
+window.windowskin = skin
+window.x, window.y = 80, 304
+window.width, window.height = 480, 160
+window.contents = Bitmap.new(448, 128)
+
+contents = window.contents
+draw_time = 0.0
+
+start = now
+
+FRAMES.times do
+  t = now
+  contents.clear
+
+  LINES.each_with_index do |line, i|
+    x = 0
+
+    line.each_char do |c|
+      w = contents.text_size(c).width
+      contents.draw_text(4 + x, 32 * i, w * 2, 32, c)
+      x += w
+    end
+  end
+
+  draw_time += now - t
+  Graphics.update
+end
+
+total = now - start
+
+File.open("bench_message_window.txt", "a") do |f|
+  chars = LINES.join.size
+
+  f.puts format("%d frames, %d draw_text calls each: text %.3f ms/frame " \
+                "(%.2f us/char), %.1f fps overall",
+                FRAMES, chars, draw_time * 1000 / FRAMES,
+                draw_time * 1e6 / (FRAMES * chars), FRAMES / total)
+end
+
+window.dispose
+skin.dispose
@@ -0,0 +1,68 @@
+# Path lookup benchmark (FileSystem::openRead)
+#
+# Loads bitmaps by extension-less name out of a directory
+# holding 20000 files, the way RGSS scripts refer to them,
+# and times 10000 hits and 10000 misses.
+#
+# 1. Generate the file tree with plain Ruby:
+#      ruby path_lookup.rb /path/to/game
+# 2. Run mkxp in that game folder with
+#      customScript=/path/to/path_lookup.rb
+#      headless=true
+#    Adding traceFile=trace.json isolates the time spent in
+#    FileSystem::openRead from the image decoding.
+#
+# Results are appended to bench_path_lookup.txt.
+
+DIR = "Graphics/Characters"
+FILES = 20000
+OPENS = 10000
+
+# 1x1 transparent RGBA image
+PNG = "iVBORw0KGgoAAAANSUhEUgAAAAEAAAABCAYAAAAfFcSJAAAAC0lEQVR4nGNgAAIAAAUAAXpeqz8AAAAASUVORK5CYII=".unpack("m")[0]
+
+def now
+  Process.clock_gettime(Process::CLOCK_MONOTONIC)
+end
+
+unless defined?(Graphics)
+  root = ARGV[0] || "."
+  path = root
+
+  DIR.split("/").each do |part|
+    path = File.join(path, part)
+    Dir.mkdir(path) unless File.directory?(path)
+  end
+
+  FILES.times do |i|
+    File.open(File.join(path, format("bench%05d.png", i)), "wb") { |f| f.write(PNG) }
+  end
+
+  puts "Wrote #{FILES} files to #{path}"
+  exit
+end
+
+# Spread the opens over the whole directory
+# (7919 is coprime to FILES, so no name repeats)
+hits = Array.new(OPENS) { |i| format("%s/bench%05d", DIR, i * 7919 % FILES) }
+misses = Array.new(OPENS) { |i| format("%s/missing%05d", DIR, i) }
+
+t = now
+hits.each { |name| Bitmap.new(name).dispose }
+hit_time = now - t
+
+t = now
+misses.each do |name|
+  begin
+    Bitmap.new(name)
+  rescue Errno::ENOENT
+  end
+end
+miss_time = now - t
+
+File.open("bench_path_lookup.txt", "a") do |f|
+  f.puts format("%d files, %d opens: hits %.1f ms (%.2f us each, incl. decode), " \
+                "misses %.1f ms (%.2f us each)",
+                FILES, OPENS, hit_time * 1000, hit_time * 1e6 / OPENS,
+                miss_time * 1000, miss_time * 1e6 / OPENS)
+end
@@ -0,0 +1,76 @@
+# RGSSAD read benchmark (RGSS_ioRead / RGSS_ioSeek)
+#
+# Decodes one large entry out of an encrypted Game.rgssad.
+#
+# 1. Generate the archive with plain Ruby (size in MB,
+#    default 200):
+#      ruby rgssad_read.rb /path/to/game [size]
+# 2. Run mkxp in that game folder with
+#      customScript=/path/to/rgssad_read.rb
+#      RTP=/path/to/game/Game.rgssad
+#      headless=true
+#    once with mmapArchives=false and once with true.
+#
+# The whole entry is read sequentially via load_data, which
+# goes through the aligned bulk xor path. Scripts can't seek,
+# so random access is covered by rgssad_seek.cpp, which runs
+# against the same archive.
+#
+# Results are appended to bench_rgssad_read.txt.
+
+ENTRY = "Data/Bench.rxdata"
+RUNS = 5
+
+def now
+  Process.clock_gettime(Process::CLOCK_MONOTONIC)
+end
+
+unless defined?(Graphics)
+  root = ARGV[0] || "."
+  size_mb = (ARGV[1] || 200).to_i
+
+  # The entry is a marshaled string, so load_data can read it
+  chunk = Random.new(1).bytes(1024 * 1024)
+  data = Marshal.dump(chunk * size_mb)
+  data << "\0" * (-data.bytesize % 4)
+
+  magic = 0xDEADCAFE
+  advance = lambda do
+    old = magic
+    magic = (magic * 7 + 3) & 0xFFFFFFFF
+    old
+  end
+
+  File.open(File.join(root, "Game.rgssad"), "wb") do |f|
+    f.write("RGSSAD\0\x01")
+
+    name = ENTRY.tr("/", "\\")
+    f.write([name.bytesize ^ advance.call].pack("V"))
+    f.write(name.bytes.map { |b| b ^ (advance.call & 0xFF) }.pack("C*"))
+    f.write([data.bytesize ^ advance.call].pack("V"))
+
+    step = 1024 * 1024
+
+    (0...data.bytesize).step(step) do |offset|
+      dwords = data.byteslice(offset, step).unpack("V*")
+      f.write(dwords.map! { |d| d ^ advance.call }.pack("V*"))
+    end
+  end
+
+  puts "Wrote #{data.bytesize / (1024 * 1024)} MB entry to #{root}/Game.rgssad"
+  exit
+end
+
+times = Array.new(RUNS) do
+  t = now
+  size = load_data(ENTRY).bytesize
+  [now - t, size]
+end
+
+best, size = times.min_by { |time, _| time }
+mb = size / (1024.0 * 1024)
+
+File.open("bench_rgssad_read.txt", "a") do |f|
+  f.puts format("%.0f MB sequential: best of %d %.1f ms (%.0f MB/s, incl. Marshal.load)",
+                mb, RUNS, best * 1000, mb / best)
+end
@@ -0,0 +1,312 @@
+/* RGSSAD random access benchmark (RGSS_ioSeek / RGSS_ioRead)
+ *
+ * Opens one entry of a version 1 archive (eg. the one written
+ * by rgssad_read.rb) through the RGSS archiver, seeks it to
+ * random offsets and compares every read against a plain
+ * sequential decode of the entry done here, one magic step
+ * per dword. This checks the closed-form magic RGSS_ioSeek
+ * computes, in both the file and the memory mapped path.
+ *
+ * Build from the repository root with
+ *   c++ -O2 -Isrc benchmarks/rgssad_seek.cpp src/rgssad.cpp \
+ *     $(pkg-config --cflags --libs physfs sdl2) -o rgssad_seek
+ * and run
+ *   ./rgssad_seek /path/to/game/Game.rgssad [seeks]
+ */
+
+#include "rgssad.h"
+
+#include <physfs.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#define ENTRY_NAME "Data\\Bench.rxdata"
+#define MAX_READ 4096
+
+static double now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Plain stdio backed PHYSFS_Io for handing the archive
+ * to the archiver without mounting it */
+struct FileIo
+{
+	std::string path;
+	FILE *f;
+};
+
+static PHYSFS_sint64 fileRead(PHYSFS_Io *io, void *buf, PHYSFS_uint64 len)
+{
+	return fread(buf, 1, len, static_cast<FileIo*>(io->opaque)->f);
+}
+
+static PHYSFS_sint64 fileWrite(PHYSFS_Io*, const void*, PHYSFS_uint64)
+{
+	return -1;
+}
+
+static int fileSeek(PHYSFS_Io *io, PHYSFS_uint64 offset)
+{
+	return fseeko(static_cast<FileIo*>(io->opaque)->f, offset, SEEK_SET) == 0;
+}
+
+static PHYSFS_sint64 fileTell(PHYSFS_Io *io)
+{
+	return ftello(static_cast<FileIo*>(io->opaque)->f);
+}
+
+static PHYSFS_sint64 fileLength(PHYSFS_Io *io)
+{
+	FILE *f = static_cast<FileIo*>(io->opaque)->f;
+	off_t pos = ftello(f);
+
+	fseeko(f, 0, SEEK_END);
+	off_t length = ftello(f);
+	fseeko(f, pos, SEEK_SET);
+
+	return length;
+}
+
+static int fileFlush(PHYSFS_Io*)
+{
+	return 1;
+}
+
+static PHYSFS_Io *openFileIo(const std::string &path);
+
+static PHYSFS_Io *fileDuplicate(PHYSFS_Io *io)
+{
+	PHYSFS_Io *dup = openFileIo(static_cast<FileIo*>(io->opaque)->path);
+
+	if (dup)
+		dup->seek(dup, io->tell(io));
+
+	return dup;
+}
+
+static void fileDestroy(PHYSFS_Io *io)
+{
+	FileIo *file = static_cast<FileIo*>(io->opaque);
+
+	fclose(file->f);
+	delete file;
+	delete io;
+}
+
+static PHYSFS_Io *openFileIo(const std::string &path)
+{
+	FILE *f = fopen(path.c_str(), "rb");
+
+	if (!f)
+		return 0;
+
+	FileIo *file = new FileIo;
+	file->path = path;
+	file->f = f;
+
+	PHYSFS_Io *io = new PHYSFS_Io;
+	io->version = 0;
+	io->opaque = file;
+	io->read = fileRead;
+	io->write = fileWrite;
+	io->seek = fileSeek;
+	io->tell = fileTell;
+	io->length = fileLength;
+	io->duplicate = fileDuplicate;
+	io->flush = fileFlush;
+	io->destroy = fileDestroy;
+
+	return io;
+}
+
+static uint32_t advanceMagic(uint32_t &magic)
+{
+	uint32_t old = magic;
+	magic = magic * 7 + 3;
+
+	return old;
+}
+
+static uint32_t readUint32(const std::vector<uint8_t> &buf, size_t pos)
+{
+	return buf[pos] | buf[pos+1] << 8 | buf[pos+2] << 16 | (uint32_t) buf[pos+3] << 24;
+}
+
+/* Finds ENTRY_NAME in the raw archive and decodes it front
+ * to back, without any of the archiver's shortcuts */
+static bool decodeEntry(const std::string &path, std::vector<uint8_t> &out)
+{
+	std::vector<uint8_t> buf;
+	FILE *f = fopen(path.c_str(), "rb");
+
+	if (!f)
+		return false;
+
+	fseeko(f, 0, SEEK_END);
+	buf.resize(ftello(f));
+	fseeko(f, 0, SEEK_SET);
+
+	bool ok = fread(&buf[0], 1, buf.size(), f) == buf.size();
+	fclose(f);
+
+	if (!ok || buf.size() < 8 || memcmp(&buf[0], "RGSSAD\0\x01", 8))
+		return false;
+
+	uint32_t magic = 0xDEADCAFE;
+	size_t pos = 8;
+
+	while (pos + 4 <= buf.size())
+	{
+		uint32_t nameLen = readUint32(buf, pos) ^ advanceMagic(magic);
+		pos += 4;
+
+		if (pos + nameLen + 4 > buf.size())
+			return false;
+
+		std::string name;
+
+		for (uint32_t i = 0; i < nameLen; ++i)
+			name += (char) (buf[pos++] ^ (advanceMagic(magic) & 0xFF));
+
+		uint32_t size = readUint32(buf, pos) ^ advanceMagic(magic);
+		pos += 4;
+
+		if (pos + size > buf.size())
+			return false;
+
+		if (name != ENTRY_NAME)
+		{
+			pos += size;
+			continue;
+		}
+
+		out.resize(size);
+
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			out[i] = buf[pos + i] ^ (magic >> 8 * (i % 4));
+
+			if (i % 4 == 3)
+				advanceMagic(magic);
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+/* Returns the number of mismatching reads, or -1 on error */
+static int run(const char *path, const std::vector<uint8_t> &ref, int seeks, bool mmap)
+{
+	RGSS_setMmapEnabled(mmap);
+
+	PHYSFS_Io *archIo = openFileIo(path);
+
+	if (!archIo)
+		return -1;
+
+	int claimed = 0;
+	void *archive = RGSS1_Archiver.openArchive(archIo, path, 0, &claimed);
+
+	if (!archive)
+	{
+		archIo->destroy(archIo);
+		return -1;
+	}
+
+	std::string name(ENTRY_NAME);
+	name[name.find('\\')] = '/';
+
+	PHYSFS_Io *io = RGSS1_Archiver.openRead(archive, name.c_str());
+
+	if (!io)
+	{
+		RGSS1_Archiver.closeArchive(archive);
+		archIo->destroy(archIo);
+		return -1;
+	}
+
+	/* Same sequence of seeks for both modes */
+	srand(1);
+
+	std::vector<uint8_t> buf(MAX_READ);
+	int mismatches = 0;
+	uint64_t bytes = 0;
+
+	double start = now();
+
+	for (int i = 0; i < seeks; ++i)
+	{
+		uint64_t offset = ((uint64_t) rand() * RAND_MAX + rand()) % ref.size();
+		uint64_t len = 1 + rand() % MAX_READ;
+
+		if (len > ref.size() - offset)
+			len = ref.size() - offset;
+
+		if (!io->seek(io, offset) ||
+		    io->read(io, &buf[0], len) != (PHYSFS_sint64) len ||
+		    memcmp(&buf[0], &ref[offset], len))
+			++mismatches;
+
+		bytes += len;
+	}
+
+	double time = now() - start;
+
+	printf("%s: %d random reads (%.1f MB) in %.1f ms, %.2f us per seek+read, %d mismatches\n",
+	       mmap ? "mmap" : "file", seeks, bytes / (1024.0 * 1024), time * 1000,
+	       time * 1e6 / seeks, mismatches);
+
+	io->destroy(io);
+	RGSS1_Archiver.closeArchive(archive);
+	archIo->destroy(archIo);
+
+	return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s Game.rgssad [seeks]\n", argv[0]);
+		return 1;
+	}
+
+	const char *path = argv[1];
+	int seeks = argc > 2 ? atoi(argv[2]) : 100000;
+
+	if (!PHYSFS_init(argv[0]))
+		return 1;
+
+	std::vector<uint8_t> ref;
+
+	if (!decodeEntry(path, ref) || ref.empty())
+	{
+		fprintf(stderr, "No entry '%s' in %s\n", ENTRY_NAME, path);
+		return 1;
+	}
+
+	int fileResult = run(path, ref, seeks, false);
+	int mmapResult = run(path, ref, seeks, true);
+
+	PHYSFS_deinit();
+
+	if (fileResult < 0 || mmapResult < 0)
+	{
+		fprintf(stderr, "Failed to open '%s' through the archiver\n", ENTRY_NAME);
+		return 1;
+	}
+
+	return (fileResult == 0 && mmapResult == 0) ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+# Table bulk operation benchmark (Table#fill, #copy_rect,
+# #to_s, Table.from_s)
+#
+# Times each bulk operation against the per-cell Table#[] /
+# Table#[]= loop doing the same work, on a 500x500x3 table.
+# The second pass attaches the table to a Tilemap, so every
+# change notification also reaches its dirty tracking.
+#
+# Run mkxp with
+#   customScript=/path/to/table_ops.rb
+#   headless=true
+#
+# Results are appended to bench_table_ops.txt.
+
+XS, YS, ZS = 500, 500, 3
+RECT = Rect.new(50, 50, 300, 300)
+RUNS = 3
+
+def now
+  Process.clock_gettime(Process::CLOCK_MONOTONIC)
+end
+
+# Best of RUNS, in milliseconds
+def measure
+  Array.new(RUNS) do
+    t = now
+    yield
+    (now - t) * 1000
+  end.min
+end
+
+def run(table, out)
+  src = Table.new(XS, YS, ZS)
+  src.fill(7)
+
+  cases = []
+
+  cases << ["fill",
+    measure { ZS.times { |z| YS.times { |y| XS.times { |x| table[x, y, z] = 5 } } } },
+    measure { table.fill(5) }]
+
+  cases << ["copy_rect",
+    measure do
+      ZS.times do |z|
+        RECT.height.times do |j|
+          RECT.width.times do |i|
+            table[i, j, z] = src[RECT.x + i, RECT.y + j, z]
+          end
+        end
+      end
+    end,
+    measure { table.copy_rect(src, RECT, 0, 0) }]
+
+  data = nil
+
+  cases << ["to_s",
+    measure do
+      cells = []
+      ZS.times { |z| YS.times { |y| XS.times { |x| cells << table[x, y, z] } } }
+      data = cells.pack("s*")
+    end,
+    measure { data = table.to_s }]
+
+  cases << ["from_s",
+    measure do
+      cells = data.unpack("s*")
+      t = Table.new(XS, YS, ZS)
+      i = 0
+      ZS.times { |z| YS.times { |y| XS.times { |x| t[x, y, z] = cells[i]; i += 1 } } }
+    end,
+    measure { Table.from_s(data, XS, YS, ZS) }]
+
+  cases.each do |name, loop_ms, bulk_ms|
+    out.puts format("  %-10s per-cell %8.1f ms, bulk %7.2f ms (%.0fx)",
+                    name, loop_ms, bulk_ms, loop_ms / bulk_ms)
+  end
+end
+
+File.open("bench_table_ops.txt", "a") do |f|
+  f.puts "#{XS}x#{YS}x#{ZS} table, best of #{RUNS}:"
+  run(Table.new(XS, YS, ZS), f)
+
+  tilemap = Tilemap.new
+  tilemap.map_data = Table.new(XS, YS, ZS)
+
+  f.puts "Attached to a Tilemap:"
+  run(tilemap.map_data, f)
+
+  tilemap.dispose
+end
@@ -30,7 +30,9 @@
 #include "debugwriter.h"
 #include "graphics.h"
 #include "audio.h"
+#include "input.h"
 #include "boost-hash.h"
+#include "tracer.h"
 
 #include <ruby.h>
 #ifndef RUBY_LEGACY_VERSION
@@ -106,6 +108,7 @@ RB_METHOD(mkxpPlatform);
 RB_METHOD(mkxpUserLanguage);
 RB_METHOD(mkxpGameTitle);
 RB_METHOD(mkxpPowerState);
+RB_METHOD(mkxpDumpTrace);
 RB_METHOD(mkxpSettingsMenu);
 
 static void mriBindingInit()
@@ -173,6 +176,7 @@ static void mriBindingInit()
 	_rb_define_module_function(mod, "mouse_in_window", mkxpMouseInWindow);
     _rb_define_module_function(mod, "platform", mkxpPlatform);
     _rb_define_module_function(mod, "power_state", mkxpPowerState);
+	_rb_define_module_function(mod, "dump_trace", mkxpDumpTrace);
     
     VALUE sys = rb_define_module("System");
     _rb_define_module_function(sys, "data_directory", mkxpDataDirectory);
@@ -291,7 +295,7 @@ RB_METHOD(mkxpRawKeyStates)
 	RB_UNUSED_PARAM;
 
 	VALUE str = rb_str_new(0, sizeof(EventThread::keyStates));
-	memcpy(RSTRING_PTR(str), EventThread::keyStates, sizeof(EventThread::keyStates));
+	memcpy(RSTRING_PTR(str), shState->input().rawKeyStates(), sizeof(EventThread::keyStates));
 
 	return str;
 }
@@ -300,7 +304,7 @@ RB_METHOD(mkxpMouseInWindow)
 {
 	RB_UNUSED_PARAM;
 
-	return rb_bool_new(EventThread::mouseState.inWindow);
+	return rb_bool_new(shState->input().mouseInWindow());
 }
 
 RB_METHOD(mkxpPlatform)
@@ -328,6 +332,17 @@ RB_METHOD(mkxpPowerState)
     return hash;
 }
 
+RB_METHOD(mkxpDumpTrace)
+{
+	RB_UNUSED_PARAM;
+
+	const char *filename;
+
+	rb_get_args(argc, argv, "z", &filename RB_ARG_END);
+
+	return rb_bool_new(Tracer::dump(filename));
+}
+
 RB_METHOD(mkxpUserLanguage) {
   RB_UNUSED_PARAM;
 
@@ -808,6 +823,11 @@ static void mriBindingExecute()
 
 	mriBindingInit();
 
+	/* Replays only play out the same if 'rand' does */
+	unsigned int seed;
+	if (shState->input().getLogSeed(seed))
+		rb_funcall(rb_mKernel, rb_intern("srand"), 1, UINT2NUM(seed));
+
 	std::string &customScript = conf.customScript;
 	if (!customScript.empty())
 		runCustomScript(customScript);
@@ -23,6 +23,9 @@
 #include "font.h"
 #include "exception.h"
 #include "sharedstate.h"
+#include "bitmapcache.h"
+#include "bitmaploader.h"
+#include "texpool.h"
 #include "disposable-binding.h"
 #include "binding-util.h"
 #include "binding-types.h"
@@ -66,6 +69,69 @@ RB_METHOD(bitmapGetMaxSize){
   return INT2NUM(Bitmap::maxSize());
 }
 
+RB_METHOD(bitmapCacheStats)
+{
+	RB_UNUSED_PARAM;
+
+	rb_check_argc(argc, 0);
+
+	BitmapCache::Stats stats = shState->bitmapCache().getStats();
+
+	VALUE hash = rb_hash_new();
+
+	rb_hash_aset(hash, ID2SYM(rb_intern("hits")), ULL2NUM(stats.hits));
+	rb_hash_aset(hash, ID2SYM(rb_intern("misses")), ULL2NUM(stats.misses));
+	rb_hash_aset(hash, ID2SYM(rb_intern("entries")), UINT2NUM(stats.entries));
+	rb_hash_aset(hash, ID2SYM(rb_intern("size")), UINT2NUM(stats.memSize));
+	rb_hash_aset(hash, ID2SYM(rb_intern("max_size")), UINT2NUM(stats.maxMemSize));
+
+	return hash;
+}
+
+RB_METHOD(bitmapTexturePoolStats)
+{
+	RB_UNUSED_PARAM;
+
+	rb_check_argc(argc, 0);
+
+	TexPool::Stats stats = shState->texPool().getStats();
+
+	VALUE hash = rb_hash_new();
+
+	rb_hash_aset(hash, ID2SYM(rb_intern("requests")), ULL2NUM(stats.requests));
+	rb_hash_aset(hash, ID2SYM(rb_intern("hits")), ULL2NUM(stats.hits));
+	rb_hash_aset(hash, ID2SYM(rb_intern("reuses")), ULL2NUM(stats.reuses));
+	rb_hash_aset(hash, ID2SYM(rb_intern("evictions")), ULL2NUM(stats.evictions));
+	rb_hash_aset(hash, ID2SYM(rb_intern("entries")), UINT2NUM(stats.entries));
+	rb_hash_aset(hash, ID2SYM(rb_intern("size")), UINT2NUM(stats.memSize));
+	rb_hash_aset(hash, ID2SYM(rb_intern("max_size")), UINT2NUM(stats.maxMemSize));
+
+	return hash;
+}
+
+RB_METHOD(bitmapCacheClear)
+{
+	RB_UNUSED_PARAM;
+
+	rb_check_argc(argc, 0);
+
+	shState->bitmapCache().clear();
+
+	return Qnil;
+}
+
+RB_METHOD(bitmapPreload)
+{
+	RB_UNUSED_PARAM;
+
+	const char *filename;
+	rb_get_args(argc, argv, "z", &filename RB_ARG_END);
+
+	shState->bitmapLoader().preload(filename);
+
+	return Qnil;
+}
+
 RB_METHOD(bitmapInitialize)
 {
 	Bitmap *b = 0;
@@ -252,6 +318,103 @@ RB_METHOD(bitmapSetPixel)
 	return self;
 }
 
+/* Returns 'rectObj', or the whole bitmap if it's nil */
+static IntRect rawDataRect(VALUE rectObj, Bitmap *b)
+{
+	if (NIL_P(rectObj))
+	{
+		IntRect rect;
+		GUARD_EXC( rect = b->rect(); );
+
+		return rect;
+	}
+
+	Rect *rect = getPrivateDataCheck<Rect>(rectObj, RectType);
+
+	return rect->toIntRect();
+}
+
+/* raw_data([rect]) */
+RB_METHOD(bitmapGetRawData)
+{
+	Bitmap *b = getPrivateData<Bitmap>(self);
+
+	VALUE rectObj = Qnil;
+
+	rb_get_args(argc, argv, "|o", &rectObj RB_ARG_END);
+
+	IntRect rect = rawDataRect(rectObj, b);
+
+	if (rect.w < 0 || rect.h < 0)
+		rb_raise(rb_eArgError, "negative rect size");
+
+	VALUE data = rb_str_new(0, (long) rect.w * rect.h * 4);
+
+	GUARD_EXC( b->getRaw(rect, RSTRING_PTR(data)); );
+
+	return data;
+}
+
+/* set_raw_data(data [, rect]) */
+RB_METHOD(bitmapSetRawData)
+{
+	Bitmap *b = getPrivateData<Bitmap>(self);
+
+	const char *data;
+	int dataLen;
+	VALUE rectObj = Qnil;
+
+	rb_get_args(argc, argv, "s|o", &data, &dataLen, &rectObj RB_ARG_END);
+
+	IntRect rect = rawDataRect(rectObj, b);
+
+	if (rect.w < 0 || rect.h < 0 ||
+	    (long) dataLen != (long) rect.w * rect.h * 4)
+		rb_raise(rb_eArgError, "data size doesn't match rect size");
+
+	GUARD_EXC( b->setRaw(rect, data); );
+
+	return self;
+}
+
+/* raw_data=(data) */
+RB_METHOD(bitmapSetRawDataAll)
+{
+	rb_check_argc(argc, 1);
+
+	bitmapSetRawData(1, argv, self);
+
+	return argv[0];
+}
+
+/* request_readback([rect]) */
+RB_METHOD(bitmapRequestReadback)
+{
+	Bitmap *b = getPrivateData<Bitmap>(self);
+
+	VALUE rectObj = Qnil;
+
+	rb_get_args(argc, argv, "|o", &rectObj RB_ARG_END);
+
+	IntRect rect = rawDataRect(rectObj, b);
+
+	GUARD_EXC( b->requestReadback(rect); );
+
+	return self;
+}
+
+RB_METHOD(bitmapReadbackReady)
+{
+	RB_UNUSED_PARAM;
+
+	Bitmap *b = getPrivateData<Bitmap>(self);
+
+	bool ready = false;
+	GUARD_EXC( ready = b->readbackReady(); );
+
+	return rb_bool_new(ready);
+}
+
 RB_METHOD(bitmapHueChange)
 {
 	Bitmap *b = getPrivateData<Bitmap>(self);
@@ -472,6 +635,12 @@ bitmapBindingInit()
 	_rb_define_method(klass, "clear",       bitmapClear);
 	_rb_define_method(klass, "get_pixel",   bitmapGetPixel);
 	_rb_define_method(klass, "set_pixel",   bitmapSetPixel);
+	_rb_define_method(klass, "raw_data",     bitmapGetRawData);
+	_rb_define_method(klass, "raw_data=",    bitmapSetRawDataAll);
+	_rb_define_method(klass, "set_raw_data", bitmapSetRawData);
+
+	_rb_define_method(klass, "request_readback", bitmapRequestReadback);
+	_rb_define_method(klass, "readback_ready?",  bitmapReadbackReady);
 	_rb_define_method(klass, "hue_change",  bitmapHueChange);
 	_rb_define_method(klass, "draw_text",   bitmapDrawText);
 	_rb_define_method(klass, "text_size",   bitmapTextSize);
@@ -486,6 +655,10 @@ bitmapBindingInit()
     
     _rb_define_method(klass, "mega?", bitmapGetMega);
     rb_define_singleton_method(klass, "max_size", RUBY_METHOD_FUNC(bitmapGetMaxSize), 0);
+	rb_define_singleton_method(klass, "cache_stats", RUBY_METHOD_FUNC(bitmapCacheStats), -1);
+	rb_define_singleton_method(klass, "texture_pool_stats", RUBY_METHOD_FUNC(bitmapTexturePoolStats), -1);
+	rb_define_singleton_method(klass, "clear_cache", RUBY_METHOD_FUNC(bitmapCacheClear), -1);
+	rb_define_singleton_method(klass, "preload", RUBY_METHOD_FUNC(bitmapPreload), -1);
 
 
 	INIT_PROP_BIND(Bitmap, Font, "font");
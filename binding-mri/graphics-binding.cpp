@@ -22,6 +22,8 @@
 #include "graphics.h"
 #include "sharedstate.h"
 #include "filesystem.h"
+#include "bitmaploader.h"
+#include "framestats.h"
 #include "binding-util.h"
 #include "binding-types.h"
 #include "exception.h"
@@ -173,12 +175,17 @@ RB_METHOD(graphicsFadein)
 
 void bitmapInitProps(Bitmap *b, VALUE self);
 
+/* snap_to_bitmap([readback]) */
 RB_METHOD(graphicsSnapToBitmap)
 {
 	RB_UNUSED_PARAM;
 
+	bool readback = false;
+
+	rb_get_args(argc, argv, "|b", &readback RB_ARG_END);
+
 	Bitmap *result = 0;
-	GUARD_EXC( result = shState->graphics().snapToBitmap(); );
+	GUARD_EXC( result = shState->graphics().snapToBitmap(readback); );
 
 	VALUE obj = wrapObject(result, BitmapType);
 	bitmapInitProps(result, obj);
@@ -230,6 +237,25 @@ RB_METHOD(graphicsPlayMovie)
 	return Qnil;
 }
 
+/* Accepts any mix of filenames and arrays of filenames */
+RB_METHOD(graphicsPreload)
+{
+	RB_UNUSED_PARAM;
+
+	VALUE list = rb_ary_new4(argc, argv);
+	list = rb_funcall2(list, rb_intern("flatten"), 0, 0);
+
+	for (long i = 0; i < RARRAY_LEN(list); ++i)
+	{
+		VALUE filename = rb_ary_entry(list, i);
+		SafeStringValue(filename);
+
+		shState->bitmapLoader().preload(RSTRING_PTR(filename));
+	}
+
+	return Qnil;
+}
+
 DEF_GRA_PROP_I(FrameRate)
 DEF_GRA_PROP_I(FrameCount)
 DEF_GRA_PROP_I(Brightness)
@@ -262,6 +288,84 @@ RB_METHOD(graphicsScreenshot)
     return Qnil;
 }
 
+RB_METHOD(graphicsScreenshotAsync)
+{
+	RB_UNUSED_PARAM;
+
+	const char *filename;
+
+	rb_get_args(argc, argv, "z", &filename RB_ARG_END);
+
+	int ticket = 0;
+	GUARD_EXC( ticket = shState->graphics().screenshotAsync(filename); );
+
+	return rb_fix_new(ticket);
+}
+
+RB_METHOD(graphicsScreenshotDone)
+{
+	RB_UNUSED_PARAM;
+
+	int ticket;
+
+	rb_get_args(argc, argv, "i", &ticket RB_ARG_END);
+
+	bool done = false;
+	GUARD_EXC( done = shState->graphics().screenshotDone(ticket); );
+
+	return rb_bool_new(done);
+}
+
+static VALUE summaryToHash(const FrameStats::Summary &sum)
+{
+	VALUE hash = rb_hash_new();
+	rb_hash_aset(hash, ID2SYM(rb_intern("min")), rb_float_new(sum.min));
+	rb_hash_aset(hash, ID2SYM(rb_intern("avg")), rb_float_new(sum.avg));
+	rb_hash_aset(hash, ID2SYM(rb_intern("p99")), rb_float_new(sum.p99));
+	rb_hash_aset(hash, ID2SYM(rb_intern("max")), rb_float_new(sum.max));
+
+	return hash;
+}
+
+/* Returns { :frames => n, :script => { :min, :avg, :p99, :max }, ... }
+ * with all times in milliseconds. With GPU timers enabled, :gpu holds
+ * the same per element category, eg. { :sprites => { ... }, ... } */
+RB_METHOD(graphicsFrameStats)
+{
+	RB_UNUSED_PARAM;
+
+	const FrameStats &stats = shState->graphics().getFrameStats();
+
+	VALUE hash = rb_hash_new();
+	rb_hash_aset(hash, ID2SYM(rb_intern("frames")), INT2NUM(stats.frameCount()));
+
+	for (int i = 0; i < FrameStats::PhaseCount; ++i)
+	{
+		FrameStats::Phase phase = (FrameStats::Phase) i;
+
+		rb_hash_aset(hash, ID2SYM(rb_intern(FrameStats::phaseName(phase))),
+		             summaryToHash(stats.getSummary(phase)));
+	}
+
+	if (stats.gpuFrameCount() > 0)
+	{
+		VALUE gpuHash = rb_hash_new();
+		rb_hash_aset(gpuHash, ID2SYM(rb_intern("frames")), INT2NUM(stats.gpuFrameCount()));
+
+		for (int i = 0; i < GpuTimer::CategoryCount; ++i)
+		{
+			GpuTimer::Category cat = (GpuTimer::Category) i;
+
+			rb_hash_aset(gpuHash, ID2SYM(rb_intern(GpuTimer::categoryName(cat))),
+			             summaryToHash(stats.getGpuSummary(cat)));
+		}
+
+		rb_hash_aset(hash, ID2SYM(rb_intern("gpu")), gpuHash);
+	}
+
+	return hash;
+}
+
 #ifdef __ANDROID__
 RB_METHOD(graphicsSendMessage)
 {
@@ -287,7 +391,11 @@ void graphicsBindingInit()
 	_rb_define_module_function(module, "transition", graphicsTransition);
 	_rb_define_module_function(module, "frame_reset", graphicsFrameReset);
     _rb_define_module_function(module, "screenshot", graphicsScreenshot);
+	_rb_define_module_function(module, "screenshot_async", graphicsScreenshotAsync);
+	_rb_define_module_function(module, "screenshot_done?", graphicsScreenshotDone);
+	_rb_define_module_function(module, "frame_stats", graphicsFrameStats);
 	_rb_define_module_function(module, "__reset__", graphicsReset);
+	_rb_define_module_function(module, "preload", graphicsPreload);
     
     
     
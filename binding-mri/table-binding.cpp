@@ -20,8 +20,11 @@
 */
 
 #include <algorithm>
+#include <string.h>
 #include "table.h"
+#include "etc.h"
 #include "binding-util.h"
+#include "binding-types.h"
 #include "serializable-binding.h"
 
 static int num2TableSize(VALUE v)
@@ -155,6 +158,103 @@ RB_METHOD(tableSetAt)
 	return argv[argc - 1];
 }
 
+/* fill(value [, rect [, z]]) */
+RB_METHOD(tableFill)
+{
+	Table *t = getPrivateData<Table>(self);
+
+	int value;
+	VALUE rectObj = Qnil;
+	VALUE zObj = Qnil;
+
+	rb_get_args(argc, argv, "i|oo", &value, &rectObj, &zObj RB_ARG_END);
+
+	int x = 0, y = 0, w = t->xSize(), h = t->ySize();
+	int z = 0, d = t->zSize();
+
+	if (!NIL_P(rectObj))
+	{
+		Rect *rect = getPrivateDataCheck<Rect>(rectObj, RectType);
+
+		x = rect->x;
+		y = rect->y;
+		w = rect->width;
+		h = rect->height;
+	}
+
+	if (!NIL_P(zObj))
+	{
+		z = NUM2INT(zObj);
+		d = 1;
+	}
+
+	t->fill(value, x, y, z, w, h, d);
+
+	return self;
+}
+
+/* copy_rect(src_table, src_rect, dx, dy) */
+RB_METHOD(tableCopyRect)
+{
+	Table *t = getPrivateData<Table>(self);
+
+	VALUE srcObj, rectObj;
+	int dx, dy;
+
+	rb_get_args(argc, argv, "ooii", &srcObj, &rectObj, &dx, &dy RB_ARG_END);
+
+	Table *src = getPrivateDataCheck<Table>(srcObj, TableType);
+	Rect *rect = getPrivateDataCheck<Rect>(rectObj, RectType);
+
+	t->copyRect(*src, rect->x, rect->y, rect->width, rect->height, dx, dy);
+
+	return self;
+}
+
+/* Raw cell data as a binary string of native
+ * int16 values (x varies fastest, then y, then z) */
+RB_METHOD(tableToS)
+{
+	RB_UNUSED_PARAM;
+
+	Table *t = getPrivateData<Table>(self);
+
+	long size = (long) t->xSize() * t->ySize() * t->zSize();
+
+	if (size == 0)
+		return rb_str_new(0, 0);
+
+	return rb_str_new(reinterpret_cast<const char*>(&t->at(0)),
+	                  size * sizeof(int16_t));
+}
+
+/* Table.from_s(data, xsize [, ysize [, zsize]]) */
+RB_METHOD(tableFromS)
+{
+	const char *data;
+	int dataLen;
+	int x, y = 1, z = 1;
+
+	rb_get_args(argc, argv, "si|ii", &data, &dataLen, &x, &y, &z RB_ARG_END);
+
+	x = std::max(x, 0);
+	y = std::max(y, 0);
+	z = std::max(z, 0);
+
+	if ((long) dataLen != (long) x * y * z * (long) sizeof(int16_t))
+		rb_raise(rb_eArgError, "data size doesn't match table dimensions");
+
+	Table *t = new Table(x, y, z);
+
+	if (dataLen > 0)
+		memcpy(&t->at(0), data, dataLen);
+
+	VALUE obj = rb_obj_alloc(self);
+	setPrivateData(obj, t);
+
+	return obj;
+}
+
 MARSH_LOAD_FUN(Table)
 INITCOPY_FUN(Table)
 
@@ -167,6 +267,7 @@ tableBindingInit()
 	serializableBindingInit<Table>(klass);
 
 	rb_define_class_method(klass, "_load", TableLoad);
+	rb_define_class_method(klass, "from_s", tableFromS);
 
 	_rb_define_method(klass, "initialize", tableInitialize);
 	_rb_define_method(klass, "initialize_copy", TableInitializeCopy);
@@ -176,5 +277,8 @@ tableBindingInit()
 	_rb_define_method(klass, "zsize", tableZSize);
 	_rb_define_method(klass, "[]", tableGetAt);
 	_rb_define_method(klass, "[]=", tableSetAt);
+	_rb_define_method(klass, "fill", tableFill);
+	_rb_define_method(klass, "copy_rect", tableCopyRect);
+	_rb_define_method(klass, "to_s", tableToS);
 
 }
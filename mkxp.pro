@@ -99,6 +99,16 @@ HEADERS += \
 	src/sprite.h \
 	src/table.h \
 	src/texpool.h \
+	src/bitmapcache.h \
+	src/bitmapatlas.h \
+	src/textcache.h \
+	src/screenshotwriter.h \
+	src/framestats.h \
+	src/tracer.h \
+	src/gputimer.h \
+	src/inputlog.h \
+	src/shadercache.h \
+	src/bitmaploader.h \
 	src/tilequad.h \
 	src/transform.h \
 	src/viewport.h \
@@ -107,6 +117,7 @@ HEADERS += \
 	src/shader.h \
 	src/glstate.h \
 	src/quad.h \
+	src/spritebatch.h \
 	src/tilemap.h \
 	src/tilemap-common.h \
 	src/graphics.h \
@@ -154,11 +165,22 @@ SOURCES += \
 	src/plane.cpp \
 	src/scene.cpp \
 	src/sprite.cpp \
+	src/spritebatch.cpp \
 	src/table.cpp \
 	src/tilequad.cpp \
 	src/viewport.cpp \
 	src/window.cpp \
 	src/texpool.cpp \
+	src/bitmapcache.cpp \
+	src/bitmapatlas.cpp \
+	src/textcache.cpp \
+	src/screenshotwriter.cpp \
+	src/framestats.cpp \
+	src/tracer.cpp \
+	src/gputimer.cpp \
+	src/inputlog.cpp \
+	src/shadercache.cpp \
+	src/bitmaploader.cpp \
 	src/shader.cpp \
 	src/glstate.cpp \
 	src/tilemap.cpp \
@@ -212,6 +234,8 @@ EMBED = \
 	shader/blurH.vert \
 	shader/blurV.vert \
 	shader/simpleMatrix.vert \
+	shader/spriteBatch.vert \
+	shader/spriteBatch.frag \
 	shader/tilemapvx.vert \
 	assets/gamecontrollerdb.txt \
 	assets/liberation.ttf \
@@ -30,6 +30,7 @@
 #include "fluid-fun.h"
 #include "sdl-util.h"
 #include "debugwriter.h"
+#include "tracer.h"
 
 #include <SDL_mutex.h>
 #include <SDL_thread.h>
@@ -397,6 +398,8 @@ void ALStream::streamData()
 	bool firstBuffer = true;
 	ALDataSource::Status status;
 
+	Tracer::setThreadName("alstream");
+
 	if (threadTermReq)
 		return;
 
@@ -412,7 +415,10 @@ void ALStream::streamData()
 
 		AL::Buffer::ID buf = alBuf[i];
 
-		status = source->fillBuffer(buf);
+		{
+			TRACE_SCOPE("ALStream::streamData");
+			status = source->fillBuffer(buf);
+		}
 
 		if (status == ALDataSource::Error)
 			return;
@@ -478,7 +484,10 @@ void ALStream::streamData()
 			if (sourceExhausted)
 				continue;
 
-			status = source->fillBuffer(buf);
+			{
+				TRACE_SCOPE("ALStream::streamData");
+				status = source->fillBuffer(buf);
+			}
 
 			if (status == ALDataSource::Error)
 			{
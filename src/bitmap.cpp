@@ -29,6 +29,9 @@
 
 #include <pixman.h>
 
+#include <vector>
+#include <algorithm>
+
 #include "gl-util.h"
 #include "gl-meta.h"
 #include "quad.h"
@@ -39,10 +42,15 @@
 #include "sharedstate.h"
 #include "glstate.h"
 #include "texpool.h"
+#include "bitmapatlas.h"
+#include "bitmapcache.h"
+#include "textcache.h"
+#include "bitmaploader.h"
 #include "shader.h"
 #include "filesystem.h"
 #include "font.h"
 #include "eventthread.h"
+#include "tracer.h"
 
 #define GUARD_MEGA \
 	{ \
@@ -53,6 +61,9 @@
 
 #define OUTLINE_SIZE 1
 
+/* Granularity at which the client side copy is read back */
+#define READ_TILE_SIZE 64
+
 /* Normalize (= ensure width and
  * height are positive) */
 static IntRect normalizedRect(const IntRect &rect)
@@ -80,6 +91,11 @@ struct BitmapPrivate
 
 	TEXFBO gl;
 
+	/* Small bitmaps loaded from files may live in a shared
+	 * atlas page instead; 'gl' then only holds their size.
+	 * They move to their own texture once they're modified */
+	BitmapAtlas::Slot atlasSlot;
+
 	Font *font;
 
 	/* "Mega surfaces" are a hack to allow Tilesets to be used
@@ -89,10 +105,25 @@ struct BitmapPrivate
 	SDL_Surface *megaSurface;
 
 	/* A cached version of the bitmap in client memory, for
-	 * getPixel calls. Is invalidated any time the bitmap
-	 * is modified */
+	 * getPixel calls. It is filled in READ_TILE_SIZE tiles
+	 * as they're queried; 'tileValid' tracks which tiles are
+	 * up to date. Invalidated any time the bitmap is modified */
 	SDL_Surface *surface;
 	SDL_PixelFormat *format;
+	std::vector<bool> tileValid;
+
+	/* Deferred readback into a pixel pack buffer, collected
+	 * into 'surface' once its fence has passed */
+	struct Readback
+	{
+		GLuint pbo;
+		_GLsync fence;
+		IntRect rect;
+
+		Readback()
+		    : pbo(0), fence(0)
+		{}
+	} readback;
 
 	/* The 'tainted' area describes which parts of the
 	 * bitmap are not cleared, ie. don't have 0 opacity.
@@ -101,6 +132,19 @@ struct BitmapPrivate
 	 * in the texture and blit to it directly, saving
 	 * ourselves the expensive blending calculation */
 	pixman_region16_t tainted;
+
+	/* 'setPixel()' writes that haven't been uploaded to the
+	 * texture yet, in call order. They're flushed before the
+	 * texture is used next, or at the latest on 'prepareDraw' */
+	struct PendingPixel
+	{
+		int x, y;
+		uint8_t rgba[4];
+	};
+
+	std::vector<PendingPixel> pendingPixels;
+	IntRect pendingRect;
+	sigc::connection prepareCon;
     
     std::string clipText;
 
@@ -117,6 +161,15 @@ struct BitmapPrivate
 
 	~BitmapPrivate()
 	{
+		prepareCon.disconnect();
+		discardReadback();
+
+		if (readback.pbo)
+			::gl.DeleteBuffers(1, &readback.pbo);
+
+		if (surface)
+			SDL_FreeSurface(surface);
+
 		SDL_FreeFormat(format);
 		pixman_region_fini(&tainted);
 	}
@@ -126,6 +179,200 @@ struct BitmapPrivate
 		surface = SDL_CreateRGBSurface(0, gl.width, gl.height, format->BitsPerPixel,
 		                               format->Rmask, format->Gmask,
 		                               format->Bmask, format->Amask);
+
+		tileValid.assign(tilesX() * tilesY(), false);
+	}
+
+	int tilesX() const
+	{
+		return (gl.width + READ_TILE_SIZE - 1) / READ_TILE_SIZE;
+	}
+
+	int tilesY() const
+	{
+		return (gl.height + READ_TILE_SIZE - 1) / READ_TILE_SIZE;
+	}
+
+	/* Grows 'rect' to the tiles it touches */
+	IntRect tileAligned(const IntRect &rect) const
+	{
+		int x1 = (rect.x / READ_TILE_SIZE) * READ_TILE_SIZE;
+		int y1 = (rect.y / READ_TILE_SIZE) * READ_TILE_SIZE;
+		int x2 = std::min(((rect.x + rect.w + READ_TILE_SIZE - 1) / READ_TILE_SIZE) * READ_TILE_SIZE, gl.width);
+		int y2 = std::min(((rect.y + rect.h + READ_TILE_SIZE - 1) / READ_TILE_SIZE) * READ_TILE_SIZE, gl.height);
+
+		return IntRect(x1, y1, x2 - x1, y2 - y1);
+	}
+
+	/* Whether 'surface' is up to date over all of 'rect' */
+	bool surfaceHolds(const IntRect &rect) const
+	{
+		if (!surface || rect.w <= 0 || rect.h <= 0)
+			return false;
+
+		const int tx2 = (rect.x + rect.w - 1) / READ_TILE_SIZE;
+		const int ty2 = (rect.y + rect.h - 1) / READ_TILE_SIZE;
+
+		for (int ty = rect.y / READ_TILE_SIZE; ty <= ty2; ++ty)
+			for (int tx = rect.x / READ_TILE_SIZE; tx <= tx2; ++tx)
+				if (!tileValid[ty*tilesX() + tx])
+					return false;
+
+		return true;
+	}
+
+	/* 'rect' must be tile aligned */
+	void validateTiles(const IntRect &rect)
+	{
+		const int tx2 = (rect.x + rect.w - 1) / READ_TILE_SIZE;
+		const int ty2 = (rect.y + rect.h - 1) / READ_TILE_SIZE;
+
+		for (int ty = rect.y / READ_TILE_SIZE; ty <= ty2; ++ty)
+			for (int tx = rect.x / READ_TILE_SIZE; tx <= tx2; ++tx)
+				tileValid[ty*tilesX() + tx] = true;
+	}
+
+	void copyToSurface(const IntRect &rect, const uint8_t *data)
+	{
+		const size_t rowSize = rect.w * 4;
+
+		for (int y = 0; y < rect.h; ++y)
+			memcpy((uint8_t*) surface->pixels + (rect.y + y)*surface->pitch + rect.x*4,
+			       data + y*rowSize, rowSize);
+	}
+
+	/* Synchronously reads the tile aligned 'rect' into 'surface' */
+	void readSurface(const IntRect &rect)
+	{
+		TRACE_SCOPE("Bitmap::readback");
+
+		if (!surface)
+			allocSurface();
+
+		Vec2i offset;
+		FBO::bind(texSource(offset).fbo);
+
+		if (rect.w == surface->w)
+		{
+			/* Rows are contiguous in the surface */
+			::gl.ReadPixels(offset.x + rect.x, offset.y + rect.y, rect.w, rect.h,
+			                GL_RGBA, GL_UNSIGNED_BYTE,
+			                (uint8_t*) surface->pixels + rect.y*surface->pitch);
+		}
+		else
+		{
+			std::vector<uint8_t> buffer(rect.w * rect.h * 4);
+
+			::gl.ReadPixels(offset.x + rect.x, offset.y + rect.y, rect.w, rect.h,
+			                GL_RGBA, GL_UNSIGNED_BYTE, dataPtr(buffer));
+
+			copyToSurface(rect, dataPtr(buffer));
+		}
+
+		validateTiles(rect);
+	}
+
+	/* Makes 'surface' valid over 'rect', reading back
+	 * only the tiles that aren't up to date yet */
+	void ensureSurface(const IntRect &rect)
+	{
+		collectReadback(rect);
+
+		if (surfaceHolds(rect))
+			return;
+
+		readSurface(tileAligned(rect));
+	}
+
+	/* Starts reading 'rect' into a pack buffer without waiting
+	 * for the GPU; the result is picked up by the next query
+	 * touching it. Falls back to a synchronous read if pack
+	 * buffers / fences aren't available */
+	void requestReadback(const IntRect &rect)
+	{
+		const IntRect aligned = tileAligned(rect);
+
+		if (aligned.w <= 0 || aligned.h <= 0 || surfaceHolds(aligned))
+			return;
+
+		if (!::gl.async_readback)
+		{
+			readSurface(aligned);
+			return;
+		}
+
+		discardReadback();
+
+		if (!readback.pbo)
+			::gl.GenBuffers(1, &readback.pbo);
+
+		Vec2i offset;
+		FBO::bind(texSource(offset).fbo);
+
+		::gl.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+		::gl.BufferData(GL_PIXEL_PACK_BUFFER, aligned.w * aligned.h * 4, 0, GL_STREAM_READ);
+		::gl.ReadPixels(offset.x + aligned.x, offset.y + aligned.y, aligned.w, aligned.h,
+		                GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		::gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		readback.fence = ::gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		readback.rect = aligned;
+	}
+
+	bool readbackPending() const
+	{
+		return readback.fence != 0;
+	}
+
+	bool readbackReady() const
+	{
+		if (!readbackPending())
+			return true;
+
+		GLenum status = ::gl.ClientWaitSync(readback.fence, 0, 0);
+
+		return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+	}
+
+	/* Copies a pending readback overlapping 'rect' into 'surface',
+	 * waiting for it if it hasn't completed yet */
+	void collectReadback(const IntRect &rect)
+	{
+		if (!readbackPending() || !SDL_HasIntersection(&readback.rect, &rect))
+			return;
+
+		::gl.ClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		::gl.DeleteSync(readback.fence);
+		readback.fence = 0;
+
+		if (!surface)
+			allocSurface();
+
+		const IntRect &r = readback.rect;
+
+		::gl.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+
+		void *data = ::gl.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, r.w * r.h * 4, GL_MAP_READ_BIT);
+
+		if (data)
+		{
+			copyToSurface(r, (const uint8_t*) data);
+			::gl.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+			validateTiles(r);
+		}
+
+		::gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	/* Drops a pending readback whose contents went stale */
+	void discardReadback()
+	{
+		if (!readbackPending())
+			return;
+
+		::gl.DeleteSync(readback.fence);
+		readback.fence = 0;
 	}
 
 	void clearTaintedArea()
@@ -168,10 +415,179 @@ struct BitmapPrivate
 		return result != PIXMAN_REGION_OUT;
 	}
 
-	void bindTexture(ShaderBase &shader)
+	/* Returns the texture holding the bitmap's pixels,
+	 * and the bitmap's position inside it */
+	TEXFBO &texSource(Vec2i &offset)
+	{
+		flushPixels();
+
+		if (!atlasSlot.isValid())
+		{
+			offset = Vec2i();
+			return gl;
+		}
+
+		offset = atlasSlot.rect.pos();
+		return shState->bitmapAtlas().getPage(atlasSlot.page);
+	}
+
+	void bindTexture(ShaderBase &shader, Vec2i *offsetOut = 0, Vec2i *sizeOut = 0)
+	{
+		Vec2i offset;
+		TEXFBO &tex = texSource(offset);
+		Vec2i size(tex.width, tex.height);
+
+		TEX::bind(tex.tex);
+		shader.setTexSize(size, offset);
+
+		if (offsetOut)
+			*offsetOut = offset;
+
+		if (sizeOut)
+			*sizeOut = size;
+	}
+
+	/* Moves the bitmap out of the atlas into its own texture */
+	void detachAtlas()
+	{
+		if (!atlasSlot.isValid())
+			return;
+
+		TEXFBO tex = shState->texPool().request(gl.width, gl.height);
+		TEXFBO &page = shState->bitmapAtlas().getPage(atlasSlot.page);
+
+		GLMeta::blitBegin(tex);
+		GLMeta::blitSource(page);
+		GLMeta::blitRectangle(atlasSlot.rect, Vec2i());
+		GLMeta::blitEnd();
+
+		shState->bitmapAtlas().free(atlasSlot);
+		gl = tex;
+	}
+
+	/* Makes 'gl' the up to date, dedicated backing texture */
+	void prepareWrite()
 	{
+		detachAtlas();
+		flushPixels();
+	}
+
+	void stagePixel(int x, int y, const uint8_t rgba[4])
+	{
+		PendingPixel px;
+		px.x = x;
+		px.y = y;
+		memcpy(px.rgba, rgba, sizeof(px.rgba));
+
+		if (pendingPixels.empty())
+		{
+			pendingRect = IntRect(x, y, 1, 1);
+
+			prepareCon = shState->prepareDraw.connect
+			        (sigc::mem_fun(this, &BitmapPrivate::flushPixels));
+		}
+		else
+		{
+			int x2 = std::max(pendingRect.x + pendingRect.w, x + 1);
+			int y2 = std::max(pendingRect.y + pendingRect.h, y + 1);
+
+			pendingRect.x = std::min(pendingRect.x, x);
+			pendingRect.y = std::min(pendingRect.y, y);
+			pendingRect.w = x2 - pendingRect.x;
+			pendingRect.h = y2 - pendingRect.y;
+		}
+
+		pendingPixels.push_back(px);
+	}
+
+	static bool pendingLess(const PendingPixel &a, const PendingPixel &b)
+	{
+		return (a.y != b.y) ? (a.y < b.y) : (a.x < b.x);
+	}
+
+	void flushPixels()
+	{
+		if (pendingPixels.empty())
+			return;
+
+		TRACE_SCOPE("Bitmap::flushPixels");
+
+		prepareCon.disconnect();
+
 		TEX::bind(gl.tex);
-		shader.setTexSize(Vec2i(gl.width, gl.height));
+
+		if (surfaceHolds(pendingRect))
+		{
+			/* The client side copy already holds every
+			 * write, upload the dirty area in one go */
+			GLMeta::subRectImageUpload(surface->w, pendingRect.x, pendingRect.y,
+			                           pendingRect.x, pendingRect.y,
+			                           pendingRect.w, pendingRect.h,
+			                           surface, GL_RGBA);
+			GLMeta::subRectImageEnd();
+
+			pendingPixels.clear();
+			return;
+		}
+
+		/* Sort into scanline order, keeping only the
+		 * last write to each pixel */
+		std::stable_sort(pendingPixels.begin(), pendingPixels.end(), pendingLess);
+
+		size_t count = 0;
+
+		for (size_t i = 0; i < pendingPixels.size(); ++i)
+		{
+			if (count > 0 &&
+			    pendingPixels[count-1].x == pendingPixels[i].x &&
+			    pendingPixels[count-1].y == pendingPixels[i].y)
+				--count;
+
+			pendingPixels[count++] = pendingPixels[i];
+		}
+
+		pendingPixels.resize(count);
+
+		if (count == (size_t) pendingRect.w * pendingRect.h)
+		{
+			/* Dirty area fully covered: pixels are
+			 * already laid out row by row */
+			std::vector<uint8_t> buffer(count * 4);
+
+			for (size_t i = 0; i < count; ++i)
+				memcpy(&buffer[i*4], pendingPixels[i].rgba, 4);
+
+			TEX::uploadSubImage(pendingRect.x, pendingRect.y,
+			                    pendingRect.w, pendingRect.h,
+			                    dataPtr(buffer), GL_RGBA);
+		}
+		else
+		{
+			/* Upload horizontal runs of adjacent pixels */
+			std::vector<uint8_t> run;
+
+			for (size_t i = 0; i < count;)
+			{
+				size_t j = i + 1;
+
+				while (j < count &&
+				       pendingPixels[j].y == pendingPixels[i].y &&
+				       pendingPixels[j].x == pendingPixels[j-1].x + 1)
+					++j;
+
+				run.resize((j - i) * 4);
+
+				for (size_t k = i; k < j; ++k)
+					memcpy(&run[(k-i)*4], pendingPixels[k].rgba, 4);
+
+				TEX::uploadSubImage(pendingPixels[i].x, pendingPixels[i].y,
+				                    j - i, 1, dataPtr(run), GL_RGBA);
+
+				i = j;
+			}
+		}
+
+		pendingPixels.clear();
 	}
 
 	void bindFBO()
@@ -227,13 +643,16 @@ struct BitmapPrivate
 		surf = surfConv;
 	}
 
-	void onModified(bool freeSurface = true)
+	void onModified(bool invalidateSurface = true)
 	{
-		if (surface && freeSurface)
-		{
-			SDL_FreeSurface(surface);
-			surface = 0;
-		}
+		/* Keep the surface allocated, it's likely
+		 * to be queried again */
+		if (surface && invalidateSurface)
+			std::fill(tileValid.begin(), tileValid.end(), false);
+
+		/* Even if the change was applied to 'surface', an
+		 * in-flight readback still holds the old contents */
+		discardReadback();
 
 		self->modified();
 	}
@@ -254,25 +673,70 @@ struct BitmapOpenHandler : FileSystem::OpenHandler
 	}
 };
 
-Bitmap::Bitmap(const char *filename)
+SDL_Surface *Bitmap::loadSurface(const char *filename, std::string *path)
 {
 	BitmapOpenHandler handler;
-	shState->fileSystem().openRead(handler, filename);
+	shState->fileSystem().openRead(handler, filename, path);
 	SDL_Surface *imgSurf = handler.surf;
 
 	if (!imgSurf)
 		throw Exception(Exception::SDLError, "Error loading image '%s': %s",
 		                filename, SDL_GetError());
 
-	p->ensureFormat(imgSurf, SDL_PIXELFORMAT_ABGR8888);
+	BitmapPrivate::ensureFormat(imgSurf, SDL_PIXELFORMAT_ABGR8888);
+
+	return imgSurf;
+}
+
+Bitmap::Bitmap(const char *filename)
+{
+	TRACE_SCOPE("Bitmap::load");
+
+	TEXFBO preloaded;
+
+	if (shState->bitmapLoader().takeTexture(filename, preloaded))
+	{
+		p = new BitmapPrivate(this);
+		p->gl = preloaded;
+		p->addTaintedArea(rect());
+
+		return;
+	}
+
+	BitmapCache &cache = shState->bitmapCache();
+	BitmapAtlas::Slot atlasSlot;
+	std::string path;
+
+	/* Cached surfaces are owned by the cache */
+	SDL_Surface *imgSurf = cache.lookup(filename);
+	const bool cached = (imgSurf != 0);
+
+	if (!cached)
+		imgSurf = loadSurface(filename, &path);
 
 	if (imgSurf->w > glState.caps.maxTexSize || imgSurf->h > glState.caps.maxTexSize)
 	{
-		/* Mega surface */
+		/* Mega surface (these are never stored
+		 * in the cache, so 'imgSurf' is ours) */
 		p = new BitmapPrivate(this);
 		p->megaSurface = imgSurf;
 		SDL_SetSurfaceBlendMode(p->megaSurface, SDL_BLENDMODE_NONE);
 	}
+	else if (shState->bitmapAtlas().alloc(imgSurf->w, imgSurf->h, atlasSlot))
+	{
+		/* Atlas resident */
+		p = new BitmapPrivate(this);
+		p->atlasSlot = atlasSlot;
+		p->gl.width = imgSurf->w;
+		p->gl.height = imgSurf->h;
+
+		TEX::bind(shState->bitmapAtlas().getPage(atlasSlot.page).tex);
+		TEX::uploadSubImage(atlasSlot.rect.x, atlasSlot.rect.y,
+		                    imgSurf->w, imgSurf->h, imgSurf->pixels, GL_RGBA);
+
+		if (!cached && !cache.store(filename, path, imgSurf))
+			SDL_FreeSurface(imgSurf);
+	}
 	else
 	{
 		/* Regular surface */
@@ -284,7 +748,8 @@ Bitmap::Bitmap(const char *filename)
 		}
 		catch (const Exception &e)
 		{
-			SDL_FreeSurface(imgSurf);
+			if (!cached)
+				SDL_FreeSurface(imgSurf);
 			throw e;
 		}
 
@@ -294,7 +759,8 @@ Bitmap::Bitmap(const char *filename)
 		TEX::bind(p->gl.tex);
 		TEX::uploadImage(p->gl.width, p->gl.height, imgSurf->pixels, GL_RGBA);
 
-		SDL_FreeSurface(imgSurf);
+		if (!cached && !cache.store(filename, path, imgSurf))
+			SDL_FreeSurface(imgSurf);
 	}
 
 	p->addTaintedArea(rect());
@@ -389,10 +855,14 @@ void Bitmap::stretchBlt(const IntRect &destRect,
                         const Bitmap &source, const IntRect &sourceRect,
                         int opacity)
 {
+	TRACE_SCOPE("Bitmap::stretchBlt");
+
 	guardDisposed();
 
 	GUARD_MEGA;
 
+	p->prepareWrite();
+
 	if (source.isDisposed())
 		return;
 
@@ -481,12 +951,28 @@ void Bitmap::stretchBlt(const IntRect &destRect,
 		return;
 	}
 
+	/* Sampling outside of an atlas resident source
+	 * would pick up its neighbours */
+	if (source.p->atlasSlot.isValid())
+	{
+		IntRect srcNorm = normalizedRect(sourceRect);
+
+		if (srcNorm.x < 0 || srcNorm.y < 0 ||
+		    srcNorm.x + srcNorm.w > source.width() ||
+		    srcNorm.y + srcNorm.h > source.height())
+			source.p->detachAtlas();
+	}
+
+	Vec2i srcOffset;
+	TEXFBO &srcTex = source.p->texSource(srcOffset);
+
 	if (opacity == 255 && !p->touchesTaintedArea(destRect))
 	{
 		/* Fast blit */
 		GLMeta::blitBegin(p->gl);
-		GLMeta::blitSource(source.p->gl);
-		GLMeta::blitRectangle(sourceRect, destRect);
+		GLMeta::blitSource(srcTex);
+		GLMeta::blitRectangle(IntRect(sourceRect.pos() + srcOffset, sourceRect.size()),
+		                      destRect);
 		GLMeta::blitEnd();
 	}
 	else
@@ -501,10 +987,10 @@ void Bitmap::stretchBlt(const IntRect &destRect,
 		GLMeta::blitRectangle(destRect, Vec2i());
 		GLMeta::blitEnd();
 
-		FloatRect bltSubRect((float) sourceRect.x / source.width(),
-		                     (float) sourceRect.y / source.height(),
-		                     ((float) source.width() / sourceRect.w) * ((float) destRect.w / gpTex.width),
-		                     ((float) source.height() / sourceRect.h) * ((float) destRect.h / gpTex.height));
+		FloatRect bltSubRect((float) (sourceRect.x + srcOffset.x) / srcTex.width,
+		                     (float) (sourceRect.y + srcOffset.y) / srcTex.height,
+		                     ((float) srcTex.width / sourceRect.w) * ((float) destRect.w / gpTex.width),
+		                     ((float) srcTex.height / sourceRect.h) * ((float) destRect.h / gpTex.height));
 
 		BltShader &shader = shState->shaders().blt;
 		shader.bind();
@@ -538,10 +1024,14 @@ void Bitmap::fillRect(int x, int y,
 
 void Bitmap::fillRect(const IntRect &rect, const Vec4 &color)
 {
+	TRACE_SCOPE("Bitmap::fillRect");
+
 	guardDisposed();
 
 	GUARD_MEGA;
 
+	p->prepareWrite();
+
 	p->fillRect(rect, color);
 
 	if (color.w == 0)
@@ -566,10 +1056,14 @@ void Bitmap::gradientFillRect(const IntRect &rect,
                               const Vec4 &color1, const Vec4 &color2,
                               bool vertical)
 {
+	TRACE_SCOPE("Bitmap::gradientFillRect");
+
 	guardDisposed();
 
 	GUARD_MEGA;
 
+	p->prepareWrite();
+
 	SimpleColorShader &shader = shState->shaders().simpleColor;
 	shader.bind();
 	shader.setTranslation(Vec2i());
@@ -612,10 +1106,14 @@ void Bitmap::clearRect(int x, int y, int width, int height)
 
 void Bitmap::clearRect(const IntRect &rect)
 {
+	TRACE_SCOPE("Bitmap::clearRect");
+
 	guardDisposed();
 
 	GUARD_MEGA;
 
+	p->prepareWrite();
+
 	p->fillRect(rect, Vec4());
 
 	p->onModified();
@@ -623,10 +1121,14 @@ void Bitmap::clearRect(const IntRect &rect)
 
 void Bitmap::blur()
 {
+	TRACE_SCOPE("Bitmap::blur");
+
 	guardDisposed();
 
 	GUARD_MEGA;
 
+	p->prepareWrite();
+
 	Quad &quad = shState->gpQuad();
 	FloatRect rect(0, 0, width(), height());
 	quad.setTexPosRect(rect, rect);
@@ -668,10 +1170,14 @@ void Bitmap::blur()
 
 void Bitmap::radialBlur(int angle, int divisions)
 {
+	TRACE_SCOPE("Bitmap::radialBlur");
+
 	guardDisposed();
 
 	GUARD_MEGA;
 
+	p->prepareWrite();
+
 	angle     = clamp<int>(angle, 0, 359);
 	divisions = clamp<int>(divisions, 2, 100);
 
@@ -763,9 +1269,13 @@ void Bitmap::radialBlur(int angle, int divisions)
 
 void Bitmap::clear()
 {
+	TRACE_SCOPE("Bitmap::clear");
+
 	guardDisposed();
 
 	GUARD_MEGA;
+
+	p->prepareWrite();
     
     p->clipText.clear();
 
@@ -799,18 +1309,7 @@ Color Bitmap::getPixel(int x, int y) const
 	if (x < 0 || y < 0 || x >= width() || y >= height())
 		return Vec4();
 
-	if (!p->surface)
-	{
-		p->allocSurface();
-
-		FBO::bind(p->gl.fbo);
-
-		glState.viewport.pushSet(IntRect(0, 0, width(), height()));
-
-		gl.ReadPixels(0, 0, width(), height(), GL_RGBA, GL_UNSIGNED_BYTE, p->surface->pixels);
-
-		glState.viewport.pop();
-	}
+	p->ensureSurface(IntRect(x, y, 1, 1));
 
 	uint32_t pixel = getPixelAt(p->surface, p->format, x, y);
 
@@ -826,6 +1325,11 @@ void Bitmap::setPixel(int x, int y, const Color &color)
 
 	GUARD_MEGA;
 
+	if (x < 0 || y < 0 || x >= width() || y >= height())
+		return;
+
+	p->detachAtlas();
+
 	uint8_t pixel[] =
 	{
 		(uint8_t) clamp<double>(color.red,   0, 255),
@@ -834,8 +1338,7 @@ void Bitmap::setPixel(int x, int y, const Color &color)
 		(uint8_t) clamp<double>(color.alpha, 0, 255)
 	};
 
-	TEX::bind(p->gl.tex);
-	TEX::uploadSubImage(x, y, 1, 1, &pixel, GL_RGBA);
+	p->stagePixel(x, y, pixel);
 
 	p->addTaintedArea(IntRect(x, y, 1, 1));
 
@@ -851,8 +1354,106 @@ void Bitmap::setPixel(int x, int y, const Color &color)
 	p->onModified(false);
 }
 
+static void checkRawRect(const IntRect &rect, int width, int height)
+{
+	if (rect.x < 0 || rect.y < 0 || rect.w < 0 || rect.h < 0 ||
+	    rect.x + rect.w > width || rect.y + rect.h > height)
+		throw Exception(Exception::ArgumentError,
+		                "Rect (%d, %d, %d, %d) exceeds bitmap bounds",
+		                rect.x, rect.y, rect.w, rect.h);
+}
+
+void Bitmap::getRaw(const IntRect &rect, void *data) const
+{
+	TRACE_SCOPE("Bitmap::getRaw");
+
+	guardDisposed();
+
+	GUARD_MEGA;
+
+	checkRawRect(rect, width(), height());
+
+	if (rect.w == 0 || rect.h == 0)
+		return;
+
+	const size_t rowSize = rect.w * 4;
+
+	p->collectReadback(rect);
+
+	if (p->surfaceHolds(rect))
+	{
+		/* Client side copy is up to date */
+		for (int y = 0; y < rect.h; ++y)
+			memcpy((uint8_t*) data + y*rowSize,
+			       &getPixelAt(p->surface, p->format, rect.x, rect.y + y),
+			       rowSize);
+
+		return;
+	}
+
+	Vec2i offset;
+	FBO::bind(p->texSource(offset).fbo);
+
+	gl.ReadPixels(offset.x + rect.x, offset.y + rect.y, rect.w, rect.h,
+	              GL_RGBA, GL_UNSIGNED_BYTE, data);
+}
+
+void Bitmap::requestReadback(const IntRect &rect)
+{
+	guardDisposed();
+
+	GUARD_MEGA;
+
+	checkRawRect(rect, width(), height());
+
+	p->requestReadback(rect);
+}
+
+bool Bitmap::readbackReady() const
+{
+	guardDisposed();
+
+	return p->readbackReady();
+}
+
+void Bitmap::setRaw(const IntRect &rect, const void *data)
+{
+	TRACE_SCOPE("Bitmap::setRaw");
+
+	guardDisposed();
+
+	GUARD_MEGA;
+
+	checkRawRect(rect, width(), height());
+
+	if (rect.w == 0 || rect.h == 0)
+		return;
+
+	p->prepareWrite();
+
+	TEX::bind(p->gl.tex);
+	TEX::uploadSubImage(rect.x, rect.y, rect.w, rect.h, data, GL_RGBA);
+
+	p->addTaintedArea(rect);
+
+	/* Keep the client side copy instead of throwing it away */
+	if (p->surface)
+	{
+		const size_t rowSize = rect.w * 4;
+
+		for (int y = 0; y < rect.h; ++y)
+			memcpy(&getPixelAt(p->surface, p->format, rect.x, rect.y + y),
+			       (const uint8_t*) data + y*rowSize,
+			       rowSize);
+	}
+
+	p->onModified(false);
+}
+
 void Bitmap::hueChange(int hue)
 {
+	TRACE_SCOPE("Bitmap::hueChange");
+
 	guardDisposed();
 
 	GUARD_MEGA;
@@ -860,6 +1461,8 @@ void Bitmap::hueChange(int hue)
 	if ((hue % 360) == 0)
 		return;
 
+	p->prepareWrite();
+
 	TEXFBO newTex = shState->texPool().request(width(), height());
 
 	FloatRect texRect(rect());
@@ -998,12 +1601,68 @@ static void applyShadow(SDL_Surface *&in, const SDL_PixelFormat &fm, const SDL_C
 	in = out;
 }
 
+/* Rasterizes 'str' with shadow and outline applied ('flags' being
+ * TextCache::Flags). 'rawHeight' receives the height of the plain
+ * text, before shadow / outline were added */
+static SDL_Surface *renderText(TTF_Font *font, const char *str,
+                               const SDL_Color &c, const SDL_Color &co,
+                               int flags, const SDL_PixelFormat &format,
+                               int &rawHeight)
+{
+	const bool solid = (flags & TextCache::Solid);
+	SDL_Surface *txtSurf;
+
+	if (solid)
+		txtSurf = TTF_RenderUTF8_Solid(font, str, c);
+	else
+		txtSurf = TTF_RenderUTF8_Blended(font, str, c);
+
+	if (!txtSurf)
+		return 0;
+
+	BitmapPrivate::ensureFormat(txtSurf, SDL_PIXELFORMAT_ABGR8888);
+
+	rawHeight = txtSurf->h;
+
+	if (flags & TextCache::Shadow)
+		applyShadow(txtSurf, format, c);
+
+	/* outline using TTF_Outline and blending it together with SDL_BlitSurface
+	 * FIXME: outline is forced to have the same opacity as the font color */
+	if (flags & TextCache::Outline)
+	{
+		SDL_Surface *outline;
+		/* set the next font render to render the outline */
+		TTF_SetFontOutline(font, OUTLINE_SIZE);
+		if (solid)
+			outline = TTF_RenderUTF8_Solid(font, str, co);
+		else
+			outline = TTF_RenderUTF8_Blended(font, str, co);
+
+		BitmapPrivate::ensureFormat(outline, SDL_PIXELFORMAT_ABGR8888);
+		SDL_Rect outRect = {OUTLINE_SIZE, OUTLINE_SIZE, txtSurf->w, txtSurf->h};
+
+		SDL_SetSurfaceBlendMode(txtSurf, SDL_BLENDMODE_BLEND);
+		SDL_BlitSurface(txtSurf, NULL, outline, &outRect);
+		SDL_FreeSurface(txtSurf);
+		txtSurf = outline;
+		/* reset outline to 0 */
+		TTF_SetFontOutline(font, 0);
+	}
+
+	return txtSurf;
+}
+
 void Bitmap::drawText(const IntRect &rect, const char *str, int align)
 {
+	TRACE_SCOPE("Bitmap::drawText");
+
 	guardDisposed();
 
 	GUARD_MEGA;
 
+	p->prepareWrite();
+
 	std::string fixed = fixupString(str);
 	str = fixed.c_str();
     
@@ -1022,49 +1681,38 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
 	SDL_Color c = fontColor.toSDLColor();
 	c.a = 255;
 
+	SDL_Color co = outColor.toSDLColor();
+	co.a = 255;
+
 	float txtAlpha = fontColor.norm.w;
 
-	SDL_Surface *txtSurf;
+	int cacheFlags = 0;
 
-	if (shState->rtData().config.solidFonts)
-		txtSurf = TTF_RenderUTF8_Solid(font, str, c);
-	else
-		txtSurf = TTF_RenderUTF8_Blended(font, str, c);
-    
-    if(txtSurf == NULL){
-        return;
-    }
+	if (p->font->getShadow())
+		cacheFlags |= TextCache::Shadow;
 
-	p->ensureFormat(txtSurf, SDL_PIXELFORMAT_ABGR8888);
+	if (p->font->getOutline())
+		cacheFlags |= TextCache::Outline;
 
-	int rawTxtSurfH = txtSurf->h;
+	if (shState->rtData().config.solidFonts)
+		cacheFlags |= TextCache::Solid;
 
-	if (p->font->getShadow())
-		applyShadow(txtSurf, *p->format, c);
+	TextCache &textCache = shState->textCache();
+	const std::string cacheKey =
+		TextCache::makeKey(font, TTF_GetFontStyle(font), c, co, cacheFlags, fixed);
 
-	/* outline using TTF_Outline and blending it together with SDL_BlitSurface
-	 * FIXME: outline is forced to have the same opacity as the font color */
-	if (p->font->getOutline())
+	int rawTxtSurfH = 0;
+	SDL_Surface *txtSurf = textCache.lookup(cacheKey, rawTxtSurfH);
+	bool txtSurfCached = (txtSurf != 0);
+
+	if (!txtSurf)
 	{
-		SDL_Color co = outColor.toSDLColor();
-		co.a = 255;
-		SDL_Surface *outline;
-		/* set the next font render to render the outline */
-		TTF_SetFontOutline(font, OUTLINE_SIZE);
-		if (shState->rtData().config.solidFonts)
-			outline = TTF_RenderUTF8_Solid(font, str, co);
-		else
-			outline = TTF_RenderUTF8_Blended(font, str, co);
+		txtSurf = renderText(font, str, c, co, cacheFlags, *p->format, rawTxtSurfH);
 
-		p->ensureFormat(outline, SDL_PIXELFORMAT_ABGR8888);
-		SDL_Rect outRect = {OUTLINE_SIZE, OUTLINE_SIZE, txtSurf->w, txtSurf->h}; 
+		if (!txtSurf)
+			return;
 
-		SDL_SetSurfaceBlendMode(txtSurf, SDL_BLENDMODE_BLEND);
-		SDL_BlitSurface(txtSurf, NULL, outline, &outRect);
-		SDL_FreeSurface(txtSurf);
-		txtSurf = outline;
-		/* reset outline to 0 */
-		TTF_SetFontOutline(font, 0);
+		txtSurfCached = textCache.store(cacheKey, txtSurf, rawTxtSurfH);
 	}
 
 	int alignX = rect.x;
@@ -1221,7 +1869,8 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
 		p->popViewport();
 	}
 
-	SDL_FreeSurface(txtSurf);
+	if (!txtSurfCached)
+		SDL_FreeSurface(txtSurf);
 	
 	/* FIXME: Marking text areas as tainted
 	 * creates performance issues on Android */
@@ -1316,6 +1965,8 @@ void Bitmap::setInitFont(Font *value)
 
 TEXFBO &Bitmap::getGLTypes()
 {
+	p->prepareWrite();
+
 	return p->gl;
 }
 
@@ -1332,9 +1983,22 @@ void Bitmap::ensureNonMega() const
 	GUARD_MEGA;
 }
 
-void Bitmap::bindTex(ShaderBase &shader)
+void Bitmap::ensureNonAtlas() const
 {
-	p->bindTexture(shader);
+	if (isDisposed())
+		return;
+
+	p->prepareWrite();
+}
+
+TEXFBO &Bitmap::texSource(Vec2i &offset)
+{
+	return p->texSource(offset);
+}
+
+void Bitmap::bindTex(ShaderBase &shader, Vec2i *offset, Vec2i *texSize)
+{
+	p->bindTexture(shader, offset, texSize);
 }
 
 void Bitmap::taintArea(const IntRect &rect)
@@ -1355,6 +2019,8 @@ void Bitmap::releaseResources()
 {
 	if (p->megaSurface)
 		SDL_FreeSurface(p->megaSurface);
+	else if (p->atlasSlot.isValid())
+		shState->bitmapAtlas().free(p->atlasSlot);
 	else
 		shState->texPool().release(p->gl);
 
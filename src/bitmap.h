@@ -28,6 +28,8 @@
 
 #include <sigc++/signal.h>
 
+#include <string>
+
 class Font;
 class ShaderBase;
 struct TEXFBO;
@@ -83,6 +85,18 @@ public:
 	Color getPixel(int x, int y) const;
 	void setPixel(int x, int y, const Color &color);
 
+	/* Bulk pixel transfer; 'data' holds 'rect.w * rect.h'
+	 * tightly packed RGBA8 pixels, top row first.
+	 * 'rect' must lie within the bitmap */
+	void getRaw(const IntRect &rect, void *data) const;
+	void setRaw(const IntRect &rect, const void *data);
+
+	/* Starts copying 'rect' to client memory without stalling;
+	 * once 'readbackReady()' returns true (usually the next
+	 * frame), pixel queries inside it are served from memory */
+	void requestReadback(const IntRect &rect);
+	bool readbackReady() const;
+
 	void hueChange(int hue);
 
 	enum TextAlign
@@ -112,9 +126,21 @@ public:
 	SDL_Surface *megaSurface() const;
 	void ensureNonMega() const;
 
+	/* Moves the bitmap out of the shared atlas, for users
+	 * that need a dedicated texture (repeat wrapping, smooth
+	 * sampling, raw access via 'getGLTypes()' inside a blit
+	 * sequence) */
+	void ensureNonAtlas() const;
+
+	/* Texture holding the pixels (which may be a shared atlas
+	 * page), with 'offset' set to the bitmap's origin in it */
+	TEXFBO &texSource(Vec2i &offset);
+
 	/* Binds the backing texture and sets the correct
-	 * texture size uniform in shader */
-	void bindTex(ShaderBase &shader);
+	 * texture size uniform in shader. Optionally returns
+	 * the bitmap's origin in, and the size of the bound
+	 * texture (see 'texSource()') */
+	void bindTex(ShaderBase &shader, Vec2i *offset = 0, Vec2i *texSize = 0);
 
 	/* Adds 'rect' to tainted area */
 	void taintArea(const IntRect &rect);
@@ -125,6 +151,11 @@ public:
 
 	static int maxSize();
 
+	/* Reads and decodes an image file into an ABGR8888
+	 * surface. Safe to call from any thread */
+	static SDL_Surface *loadSurface(const char *filename,
+	                                std::string *path = 0);
+
 private:
 	void releaseResources();
 	const char *klassName() const { return "bitmap"; }
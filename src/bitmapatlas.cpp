@@ -0,0 +1,377 @@
+/*
+** bitmapatlas.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitmapatlas.h"
+
+#include "sharedstate.h"
+#include "texpool.h"
+#include "gl-util.h"
+#include "glstate.h"
+
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+/* Preferred page dimension (clamped to the hardware limit) */
+static const int pageSizeDef = 1024;
+
+/* Largest bitmap dimension placed into the atlas */
+static const int entrySizeMax = 128;
+
+static const int pagesMax = 8;
+
+/* Shelf heights are rounded up to this, so
+ * entries of similar height share shelves */
+static const int shelfGranularity = 8;
+
+/* Empty border kept around each entry, so that filtering at
+ * the entry edges doesn't pick up neighbours or page edges */
+static const int entryPadding = 1;
+
+struct Span
+{
+	int x, w;
+};
+
+struct Shelf
+{
+	int y, h;
+
+	/* Sorted by x */
+	std::vector<Span> spans;
+
+	Shelf(int y, int h)
+	    : y(y), h(h)
+	{}
+
+	bool isEmpty() const
+	{
+		return spans.empty();
+	}
+
+	/* Returns the x coordinate of the first gap
+	 * at least 'w' wide, or -1 if there is none */
+	int findGap(int w, int pageW) const
+	{
+		int x = 0;
+
+		for (size_t i = 0; i < spans.size(); ++i)
+		{
+			if (spans[i].x - x >= w)
+				return x;
+
+			x = spans[i].x + spans[i].w;
+		}
+
+		if (pageW - x >= w)
+			return x;
+
+		return -1;
+	}
+
+	void insert(int x, int w)
+	{
+		Span span = { x, w };
+		size_t i = 0;
+
+		while (i < spans.size() && spans[i].x < x)
+			++i;
+
+		spans.insert(spans.begin() + i, span);
+	}
+
+	bool remove(int x)
+	{
+		for (size_t i = 0; i < spans.size(); ++i)
+		{
+			if (spans[i].x != x)
+				continue;
+
+			spans.erase(spans.begin() + i);
+			return true;
+		}
+
+		return false;
+	}
+};
+
+struct Page
+{
+	TEXFBO tex;
+
+	/* Sorted by y, covering [0, top) without gaps */
+	std::vector<Shelf> shelves;
+	int top;
+
+	int entries;
+
+	Page()
+	    : top(0),
+	      entries(0)
+	{}
+
+	bool isAllocated() const
+	{
+		return tex.tex != TEX::ID(0);
+	}
+
+	bool alloc(int w, int h, int pageSize, IntRect &rect)
+	{
+		const int shelfH = ((h + shelfGranularity - 1) / shelfGranularity) * shelfGranularity;
+
+		/* Best fit: the lowest shelf that still has room */
+		int best = -1;
+		int bestX = -1;
+
+		for (size_t i = 0; i < shelves.size(); ++i)
+		{
+			Shelf &s = shelves[i];
+
+			if (s.h < shelfH)
+				continue;
+
+			/* Don't waste tall shelves on flat entries,
+			 * unless they're empty and can be split */
+			if (!s.isEmpty() && s.h > shelfH * 2)
+				continue;
+
+			if (best >= 0 && s.h >= shelves[best].h)
+				continue;
+
+			int x = s.findGap(w, pageSize);
+
+			if (x < 0)
+				continue;
+
+			best = i;
+			bestX = x;
+		}
+
+		if (best < 0)
+		{
+			/* Open a new shelf on top */
+			if (top + shelfH > pageSize)
+				return false;
+
+			shelves.push_back(Shelf(top, shelfH));
+			top += shelfH;
+
+			best = shelves.size() - 1;
+			bestX = 0;
+		}
+		else if (shelves[best].isEmpty() && shelves[best].h > shelfH)
+		{
+			/* Split off the unused part of a merged empty shelf */
+			Shelf rest(shelves[best].y + shelfH, shelves[best].h - shelfH);
+			shelves[best].h = shelfH;
+			shelves.insert(shelves.begin() + best + 1, rest);
+		}
+
+		Shelf &shelf = shelves[best];
+		shelf.insert(bestX, w);
+		++entries;
+
+		rect = IntRect(bestX, shelf.y, w, h);
+
+		return true;
+	}
+
+	void free(const IntRect &rect)
+	{
+		size_t i = 0;
+
+		while (i < shelves.size() && shelves[i].y != rect.y)
+			++i;
+
+		assert(i < shelves.size());
+
+		if (i == shelves.size() || !shelves[i].remove(rect.x))
+			return;
+
+		--entries;
+
+		if (!shelves[i].isEmpty())
+			return;
+
+		/* Coalesce with empty neighbours */
+		if (i+1 < shelves.size() && shelves[i+1].isEmpty())
+		{
+			shelves[i].h += shelves[i+1].h;
+			shelves.erase(shelves.begin() + i + 1);
+		}
+
+		if (i > 0 && shelves[i-1].isEmpty())
+		{
+			shelves[i-1].h += shelves[i].h;
+			shelves.erase(shelves.begin() + i);
+		}
+
+		/* Give back empty space on top */
+		if (!shelves.empty() && shelves.back().isEmpty())
+		{
+			top = shelves.back().y;
+			shelves.pop_back();
+		}
+	}
+};
+
+struct BitmapAtlasPrivate
+{
+	TexPool &texPool;
+	bool enabled;
+
+	std::vector<Page> pages;
+
+	BitmapAtlasPrivate(TexPool &texPool, bool enabled)
+	    : texPool(texPool),
+	      enabled(enabled)
+	{}
+
+	int pageSize() const
+	{
+		return std::min(pageSizeDef, glState.caps.maxTexSize);
+	}
+
+	bool allocIn(size_t index, int w, int h, IntRect &rect)
+	{
+		Page &page = pages[index];
+
+		if (!page.isAllocated())
+		{
+			const int size = pageSize();
+			page.tex = texPool.request(size, size);
+		}
+
+		if (page.alloc(w, h, page.tex.width, rect))
+			return true;
+
+		releaseIfUnused(page);
+
+		return false;
+	}
+
+	void releaseIfUnused(Page &page)
+	{
+		if (page.entries > 0 || !page.isAllocated())
+			return;
+
+		texPool.release(page.tex);
+		page = Page();
+	}
+
+	void clearArea(Page &page, const IntRect &rect)
+	{
+		FBO::bind(page.tex.fbo);
+
+		glState.scissorTest.pushSet(true);
+		glState.scissorBox.pushSet(rect);
+		glState.clearColor.pushSet(Vec4());
+
+		FBO::clear();
+
+		glState.clearColor.pop();
+		glState.scissorBox.pop();
+		glState.scissorTest.pop();
+	}
+};
+
+BitmapAtlas::BitmapAtlas(TexPool &texPool, bool enabled)
+{
+	p = new BitmapAtlasPrivate(texPool, enabled);
+}
+
+BitmapAtlas::~BitmapAtlas()
+{
+	for (size_t i = 0; i < p->pages.size(); ++i)
+		if (p->pages[i].isAllocated())
+			p->texPool.release(p->pages[i].tex);
+
+	delete p;
+}
+
+bool BitmapAtlas::accepts(int width, int height) const
+{
+	return p->enabled &&
+	       width  > 0 && width  <= entrySizeMax &&
+	       height > 0 && height <= entrySizeMax;
+}
+
+bool BitmapAtlas::alloc(int width, int height, Slot &slot)
+{
+	if (!accepts(width, height))
+		return false;
+
+	const int w = width  + entryPadding*2;
+	const int h = height + entryPadding*2;
+
+	IntRect rect;
+	size_t i;
+
+	/* Fill existing pages first */
+	for (i = 0; i < p->pages.size(); ++i)
+		if (p->pages[i].isAllocated() && p->allocIn(i, w, h, rect))
+			break;
+
+	if (i == p->pages.size())
+	{
+		/* Reuse a released page, or start a new one */
+		for (i = 0; i < p->pages.size(); ++i)
+			if (!p->pages[i].isAllocated())
+				break;
+
+		if (i == p->pages.size())
+		{
+			if (p->pages.size() >= (size_t) pagesMax)
+				return false;
+
+			p->pages.push_back(Page());
+		}
+
+		if (!p->allocIn(i, w, h, rect))
+			return false;
+	}
+
+	/* Clear the entry including its padding */
+	p->clearArea(p->pages[i], rect);
+
+	slot.page = i;
+	slot.rect = IntRect(rect.x + entryPadding, rect.y + entryPadding, width, height);
+
+	return true;
+}
+
+void BitmapAtlas::free(Slot &slot)
+{
+	if (!slot.isValid())
+		return;
+
+	Page &page = p->pages[slot.page];
+	page.free(IntRect(slot.rect.x - entryPadding, slot.rect.y - entryPadding,
+	                  slot.rect.w + entryPadding*2, slot.rect.h + entryPadding*2));
+	p->releaseIfUnused(page);
+
+	slot = Slot();
+}
+
+TEXFBO &BitmapAtlas::getPage(int index)
+{
+	return p->pages[index].tex;
+}
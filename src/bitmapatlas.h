@@ -0,0 +1,73 @@
+/*
+** bitmapatlas.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITMAPATLAS_H
+#define BITMAPATLAS_H
+
+#include "etc-internal.h"
+
+class TexPool;
+struct TEXFBO;
+struct BitmapAtlasPrivate;
+
+/* Packs small, read-only bitmaps (icons, character sheets etc.)
+ * into shared texture pages, so that drawing many of them in a
+ * row needs a single texture bind and can be batched.
+ *
+ * Each page is split into horizontal shelves; entries are placed
+ * first-fit into the best fitting shelf. When entries are freed,
+ * emptied shelves are merged with their empty neighbours (and
+ * dropped entirely if they're on top), and pages without any
+ * entries are returned to the texture pool */
+class BitmapAtlas
+{
+public:
+	struct Slot
+	{
+		/* Page index, -1 if not allocated */
+		int page;
+		IntRect rect;
+
+		Slot()
+		    : page(-1)
+		{}
+
+		bool isValid() const { return page >= 0; }
+	};
+
+	BitmapAtlas(TexPool &texPool, bool enabled);
+	~BitmapAtlas();
+
+	/* Whether a bitmap of this size should be placed in the atlas */
+	bool accepts(int width, int height) const;
+
+	/* Reserves a cleared 'width' x 'height' area.
+	 * Returns false if the atlas is disabled or full */
+	bool alloc(int width, int height, Slot &slot);
+	void free(Slot &slot);
+
+	TEXFBO &getPage(int index);
+
+private:
+	BitmapAtlasPrivate *p;
+};
+
+#endif // BITMAPATLAS_H
@@ -0,0 +1,196 @@
+/*
+** bitmapcache.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitmapcache.h"
+#include "boost-hash.h"
+
+#include <physfs.h>
+
+#include <SDL_surface.h>
+
+#include <list>
+#include <cctype>
+
+struct CacheEntry
+{
+	std::string key;
+	std::string path;
+
+	PHYSFS_sint64 modtime;
+	PHYSFS_sint64 filesize;
+
+	SDL_Surface *surf;
+	uint32_t memSize;
+};
+
+typedef std::list<CacheEntry> EntryList;
+
+struct BitmapCachePrivate
+{
+	/* Most recently used entries at the front */
+	EntryList lru;
+	BoostHash<std::string, EntryList::iterator> entries;
+
+	const uint32_t maxMemSize;
+	uint32_t memSize;
+
+	uint64_t hits;
+	uint64_t misses;
+
+	BitmapCachePrivate(uint32_t maxMemSize)
+	    : maxMemSize(maxMemSize),
+	      memSize(0),
+	      hits(0),
+	      misses(0)
+	{}
+
+	static std::string makeKey(const char *filename)
+	{
+		std::string key(filename);
+
+		for (size_t i = 0; i < key.size(); ++i)
+			key[i] = (key[i] == '\\') ? '/' : tolower(key[i]);
+
+		return key;
+	}
+
+	static bool statFile(const std::string &path,
+	                     PHYSFS_sint64 &modtime, PHYSFS_sint64 &filesize)
+	{
+		PHYSFS_Stat stat;
+
+		if (!PHYSFS_stat(path.c_str(), &stat))
+			return false;
+
+		modtime = stat.modtime;
+		filesize = stat.filesize;
+
+		return true;
+	}
+
+	void remove(EntryList::iterator iter)
+	{
+		SDL_FreeSurface(iter->surf);
+		memSize -= iter->memSize;
+
+		entries.remove(iter->key);
+		lru.erase(iter);
+	}
+
+	void evictFor(uint32_t required)
+	{
+		while (!lru.empty() && memSize + required > maxMemSize)
+			remove(--lru.end());
+	}
+};
+
+BitmapCache::BitmapCache(uint32_t maxMemSize)
+{
+	p = new BitmapCachePrivate(maxMemSize);
+}
+
+BitmapCache::~BitmapCache()
+{
+	clear();
+
+	delete p;
+}
+
+SDL_Surface *BitmapCache::lookup(const char *filename)
+{
+	if (p->maxMemSize == 0)
+		return 0;
+
+	std::string key = BitmapCachePrivate::makeKey(filename);
+
+	if (!p->entries.contains(key))
+	{
+		++p->misses;
+		return 0;
+	}
+
+	EntryList::iterator iter = p->entries[key];
+
+	/* Drop the entry if the file has changed or vanished */
+	PHYSFS_sint64 modtime, filesize;
+
+	if (!BitmapCachePrivate::statFile(iter->path, modtime, filesize) ||
+	    modtime != iter->modtime || filesize != iter->filesize)
+	{
+		p->remove(iter);
+		++p->misses;
+
+		return 0;
+	}
+
+	/* Move to front */
+	p->lru.splice(p->lru.begin(), p->lru, iter);
+	++p->hits;
+
+	return iter->surf;
+}
+
+bool BitmapCache::store(const char *filename, const std::string &path,
+                        SDL_Surface *surf)
+{
+	uint32_t memSize = surf->pitch * surf->h;
+
+	if (memSize > p->maxMemSize)
+		return false;
+
+	CacheEntry entry;
+	entry.key = BitmapCachePrivate::makeKey(filename);
+	entry.path = path;
+	entry.surf = surf;
+	entry.memSize = memSize;
+
+	if (!BitmapCachePrivate::statFile(path, entry.modtime, entry.filesize))
+		return false;
+
+	if (p->entries.contains(entry.key))
+		p->remove(p->entries[entry.key]);
+
+	p->evictFor(memSize);
+
+	p->lru.push_front(entry);
+	p->entries.insert(entry.key, p->lru.begin());
+	p->memSize += memSize;
+
+	return true;
+}
+
+void BitmapCache::clear()
+{
+	while (!p->lru.empty())
+		p->remove(p->lru.begin());
+}
+
+BitmapCache::Stats BitmapCache::getStats() const
+{
+	Stats stats;
+	stats.hits = p->hits;
+	stats.misses = p->misses;
+	stats.entries = p->lru.size();
+	stats.memSize = p->memSize;
+	stats.maxMemSize = p->maxMemSize;
+
+	return stats;
+}
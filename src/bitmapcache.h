@@ -0,0 +1,70 @@
+/*
+** bitmapcache.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITMAPCACHE_H
+#define BITMAPCACHE_H
+
+#include <string>
+#include <stdint.h>
+
+struct SDL_Surface;
+struct BitmapCachePrivate;
+
+/* Keeps decoded (ABGR8888) image files around so that
+ * repeated loads of the same graphic skip decompression
+ * and format conversion. Entries are validated against
+ * the modification time and size of the file they were
+ * decoded from, and evicted in LRU order once the memory
+ * budget is exceeded */
+class BitmapCache
+{
+public:
+	BitmapCache(uint32_t maxMemSize);
+	~BitmapCache();
+
+	/* Returns the cached surface for 'filename', or null.
+	 * The surface stays owned by the cache and is only
+	 * valid until the next call to 'store()' */
+	SDL_Surface *lookup(const char *filename);
+
+	/* 'path' is the resolved file 'filename' was read from.
+	 * Takes ownership of 'surf' if true is returned */
+	bool store(const char *filename, const std::string &path,
+	           SDL_Surface *surf);
+
+	void clear();
+
+	struct Stats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint32_t entries;
+		uint32_t memSize;
+		uint32_t maxMemSize;
+	};
+
+	Stats getStats() const;
+
+private:
+	BitmapCachePrivate *p;
+};
+
+#endif // BITMAPCACHE_H
@@ -0,0 +1,382 @@
+/*
+** bitmaploader.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitmaploader.h"
+
+#include "bitmap.h"
+#include "bitmapcache.h"
+#include "texpool.h"
+#include "glstate.h"
+#include "sharedstate.h"
+#include "gl-util.h"
+#include "exception.h"
+#include "boost-hash.h"
+#include "sdl-util.h"
+#include "debugwriter.h"
+
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+#include <SDL_surface.h>
+
+#include <deque>
+#include <algorithm>
+#include <list>
+#include <vector>
+#include <cctype>
+
+struct LoadJob
+{
+	std::string filename;
+	std::string key;
+
+	/* Set by the worker */
+	std::string path;
+	SDL_Surface *surf;
+	bool done;
+
+	LoadJob(const char *filename, const std::string &key)
+	    : filename(filename),
+	      key(key),
+	      surf(0),
+	      done(false)
+	{}
+};
+
+struct Preloaded
+{
+	std::string key;
+	TEXFBO tex;
+};
+
+typedef std::list<Preloaded> PreloadedList;
+
+struct BitmapLoaderPrivate
+{
+	TexPool &texPool;
+	BitmapCache &cache;
+
+	std::vector<SDL_Thread*> workers;
+
+	/* Guards everything in this block */
+	SDL_mutex *mutex;
+	SDL_cond *workCond;
+	SDL_cond *doneCond;
+	std::deque<LoadJob*> queue;
+	BoostHash<std::string, LoadJob*> jobs;
+	bool quit;
+
+	/* Uploaded textures waiting to be picked up,
+	 * oldest first. Only touched by the RGSS thread */
+	PreloadedList preloaded;
+	BoostHash<std::string, PreloadedList::iterator> preloadedHash;
+
+	const uint32_t maxMemSize;
+	uint32_t memSize;
+
+	BitmapLoaderPrivate(uint32_t maxMemSize,
+	                    TexPool &texPool, BitmapCache &cache)
+	    : texPool(texPool),
+	      cache(cache),
+	      quit(false),
+	      maxMemSize(maxMemSize),
+	      memSize(0)
+	{
+		mutex = SDL_CreateMutex();
+		workCond = SDL_CreateCond();
+		doneCond = SDL_CreateCond();
+	}
+
+	~BitmapLoaderPrivate()
+	{
+		SDL_DestroyCond(doneCond);
+		SDL_DestroyCond(workCond);
+		SDL_DestroyMutex(mutex);
+	}
+
+	static std::string makeKey(const char *filename)
+	{
+		std::string key(filename);
+
+		for (size_t i = 0; i < key.size(); ++i)
+			key[i] = (key[i] == '\\') ? '/' : tolower(key[i]);
+
+		return key;
+	}
+
+	void workerFun()
+	{
+		SDL_LockMutex(mutex);
+
+		while (true)
+		{
+			while (queue.empty() && !quit)
+				SDL_CondWait(workCond, mutex);
+
+			if (quit)
+				break;
+
+			LoadJob *job = queue.front();
+			queue.pop_front();
+
+			SDL_UnlockMutex(mutex);
+
+			SDL_Surface *surf = 0;
+			std::string path;
+
+			try
+			{
+				surf = Bitmap::loadSurface(job->filename.c_str(), &path);
+			}
+			catch (const Exception &)
+			{
+				/* The error will be reported once the
+				 * Bitmap is actually created */
+			}
+
+			SDL_LockMutex(mutex);
+
+			job->surf = surf;
+			job->path = path;
+			job->done = true;
+
+			SDL_CondBroadcast(doneCond);
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+	void releasePreloaded(PreloadedList::iterator iter)
+	{
+		memSize -= iter->tex.width * iter->tex.height * 4;
+		texPool.release(iter->tex);
+
+		preloadedHash.remove(iter->key);
+		preloaded.erase(iter);
+	}
+
+	/* Must be called with the job already removed from 'jobs' */
+	void finishJob(LoadJob *job)
+	{
+		SDL_Surface *surf = job->surf;
+
+		if (!surf)
+		{
+			delete job;
+			return;
+		}
+
+		/* Too big for a regular texture, leave it to the
+		 * Bitmap constructor to create a mega surface */
+		if (surf->w > glState.caps.maxTexSize || surf->h > glState.caps.maxTexSize)
+		{
+			SDL_FreeSurface(surf);
+			delete job;
+			return;
+		}
+
+		uint32_t texSize = surf->w * surf->h * 4;
+
+		while (!preloaded.empty() && memSize + texSize > maxMemSize)
+			releasePreloaded(preloaded.begin());
+
+		Preloaded entry;
+		entry.key = job->key;
+
+		try
+		{
+			entry.tex = texPool.request(surf->w, surf->h);
+		}
+		catch (const Exception &)
+		{
+			SDL_FreeSurface(surf);
+			delete job;
+			return;
+		}
+
+		TEX::bind(entry.tex.tex);
+		TEX::uploadImage(entry.tex.width, entry.tex.height, surf->pixels, GL_RGBA);
+
+		if (preloadedHash.contains(entry.key))
+			releasePreloaded(preloadedHash[entry.key]);
+
+		preloaded.push_back(entry);
+		preloadedHash.insert(entry.key, --preloaded.end());
+		memSize += texSize;
+
+		/* Keep the decoded image around for later loads too */
+		if (!cache.store(job->filename.c_str(), job->path, surf))
+			SDL_FreeSurface(surf);
+
+		delete job;
+	}
+};
+
+BitmapLoader::BitmapLoader(int threadCount, TexPool &texPool,
+                           BitmapCache &cache, uint32_t maxMemSize)
+{
+	p = new BitmapLoaderPrivate(maxMemSize, texPool, cache);
+
+	for (int i = 0; i < threadCount; ++i)
+	{
+		SDL_Thread *thread = createSDLThread
+			<BitmapLoaderPrivate, &BitmapLoaderPrivate::workerFun>(p, "bitmaploader");
+
+		if (!thread)
+		{
+			Debug() << "Failed to create bitmap loader thread:" << SDL_GetError();
+			break;
+		}
+
+		p->workers.push_back(thread);
+	}
+}
+
+BitmapLoader::~BitmapLoader()
+{
+	SDL_LockMutex(p->mutex);
+	p->quit = true;
+	SDL_CondBroadcast(p->workCond);
+	SDL_UnlockMutex(p->mutex);
+
+	for (size_t i = 0; i < p->workers.size(); ++i)
+		SDL_WaitThread(p->workers[i], 0);
+
+	/* Workers are gone, no more locking needed */
+	BoostHash<std::string, LoadJob*>::const_iterator iter;
+	for (iter = p->jobs.cbegin(); iter != p->jobs.cend(); ++iter)
+	{
+		if (iter->second->surf)
+			SDL_FreeSurface(iter->second->surf);
+
+		delete iter->second;
+	}
+
+	clear();
+
+	delete p;
+}
+
+void BitmapLoader::preload(const char *filename)
+{
+	/* Without workers, preloading would just
+	 * be a blocking load */
+	if (p->workers.empty())
+		return;
+
+	std::string key = BitmapLoaderPrivate::makeKey(filename);
+
+	if (p->preloadedHash.contains(key))
+		return;
+
+	SDL_LockMutex(p->mutex);
+
+	if (!p->jobs.contains(key))
+	{
+		LoadJob *job = new LoadJob(filename, key);
+		p->jobs.insert(key, job);
+		p->queue.push_back(job);
+
+		SDL_CondSignal(p->workCond);
+	}
+
+	SDL_UnlockMutex(p->mutex);
+}
+
+void BitmapLoader::processFinished()
+{
+	std::vector<LoadJob*> finished;
+
+	SDL_LockMutex(p->mutex);
+
+	BoostHash<std::string, LoadJob*>::const_iterator iter;
+	for (iter = p->jobs.cbegin(); iter != p->jobs.cend(); ++iter)
+		if (iter->second->done)
+			finished.push_back(iter->second);
+
+	for (size_t i = 0; i < finished.size(); ++i)
+		p->jobs.remove(finished[i]->key);
+
+	SDL_UnlockMutex(p->mutex);
+
+	for (size_t i = 0; i < finished.size(); ++i)
+		p->finishJob(finished[i]);
+}
+
+bool BitmapLoader::takeTexture(const char *filename, TEXFBO &out)
+{
+	if (p->workers.empty())
+		return false;
+
+	std::string key = BitmapLoaderPrivate::makeKey(filename);
+
+	SDL_LockMutex(p->mutex);
+
+	if (p->jobs.contains(key))
+	{
+		LoadJob *job = p->jobs[key];
+
+		/* If no worker got to it yet, we're
+		 * faster loading it ourselves */
+		std::deque<LoadJob*>::iterator queued =
+			std::find(p->queue.begin(), p->queue.end(), job);
+
+		if (queued != p->queue.end())
+		{
+			p->queue.erase(queued);
+			p->jobs.remove(key);
+			SDL_UnlockMutex(p->mutex);
+
+			delete job;
+
+			return false;
+		}
+
+		while (!job->done)
+			SDL_CondWait(p->doneCond, p->mutex);
+
+		p->jobs.remove(key);
+		SDL_UnlockMutex(p->mutex);
+
+		p->finishJob(job);
+	}
+	else
+	{
+		SDL_UnlockMutex(p->mutex);
+	}
+
+	if (!p->preloadedHash.contains(key))
+		return false;
+
+	PreloadedList::iterator entry = p->preloadedHash[key];
+	out = entry->tex;
+
+	p->memSize -= out.width * out.height * 4;
+	p->preloadedHash.remove(key);
+	p->preloaded.erase(entry);
+
+	return true;
+}
+
+void BitmapLoader::clear()
+{
+	while (!p->preloaded.empty())
+		p->releasePreloaded(p->preloaded.begin());
+}
@@ -0,0 +1,62 @@
+/*
+** bitmaploader.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITMAPLOADER_H
+#define BITMAPLOADER_H
+
+#include <stdint.h>
+
+struct TEXFBO;
+struct BitmapLoaderPrivate;
+class TexPool;
+class BitmapCache;
+
+/* Decodes image files on a pool of worker threads ahead of
+ * time. Finished images are uploaded into textures on the
+ * RGSS thread (at 'prepareDraw'), and picked up by the next
+ * Bitmap constructed from the same filename */
+class BitmapLoader
+{
+public:
+	BitmapLoader(int threadCount, TexPool &texPool, BitmapCache &cache,
+	             uint32_t maxMemSize = 64000000 /* 64 MB */);
+	~BitmapLoader();
+
+	/* Queues 'filename' for decoding. Does nothing if it
+	 * is already queued or preloaded */
+	void preload(const char *filename);
+
+	/* Uploads all images finished decoding so far */
+	void processFinished();
+
+	/* If 'filename' was preloaded, hands over its texture and
+	 * returns true. Waits for the image if it's still being
+	 * decoded. On false, the caller has to load it itself */
+	bool takeTexture(const char *filename, TEXFBO &out);
+
+	/* Releases all preloaded textures */
+	void clear();
+
+private:
+	BitmapLoaderPrivate *p;
+};
+
+#endif // BITMAPLOADER_H
@@ -83,6 +83,11 @@ public:
 		return p[key];
 	}
 
+	inline void clear()
+	{
+		p.clear();
+	}
+
 	inline const_iterator cbegin() const
 	{
 		return p.cbegin();
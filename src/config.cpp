@@ -161,6 +161,15 @@ void Config::read(int argc, char *argv[])
 	PO_DESC(rgssVersion, int, 0) \
 	PO_DESC(debugMode, bool, false) \
 	PO_DESC(printFPS, bool, false) \
+	PO_DESC(frameStatsOverlay, bool, false) \
+	PO_DESC(traceFile, std::string, "") \
+	PO_DESC(gpuTimers, bool, false) \
+	PO_DESC(headless, bool, false) \
+	PO_DESC(benchmarkFrames, int, 0) \
+	PO_DESC(benchmarkReport, std::string, "") \
+	PO_DESC(inputRecord, std::string, "") \
+	PO_DESC(inputReplay, std::string, "") \
+	PO_DESC(shaderCache, bool, true) \
 	PO_DESC(winResizable, bool, false) \
 	PO_DESC(fullscreen, bool, false) \
 	PO_DESC(fixedAspectRatio, bool, true) \
@@ -178,12 +187,20 @@ void Config::read(int argc, char *argv[])
 	PO_DESC(solidFonts, bool, false) \
 	PO_DESC(subImageFix, bool, false) \
 	PO_DESC(enableBlitting, bool, true) \
+	PO_DESC(spriteBatching, bool, true) \
+	PO_DESC(tilemapBuildMargin, int, 8) \
 	PO_DESC(maxTextureSize, int, 0) \
+	PO_DESC(texturePoolSize, int, 20) \
+	PO_DESC(bitmapCacheSize, int, 32) \
+	PO_DESC(bitmapAtlas, bool, false) \
+	PO_DESC(textCacheSize, int, 4) \
+	PO_DESC(preloadThreads, int, 2) \
 	PO_DESC(gameFolder, std::string, ".") \
     PO_DESC(copyText, bool, false) \
 	PO_DESC(anyAltToggleFS, bool, false) \
 	PO_DESC(enableReset, bool, true) \
 	PO_DESC(allowSymlinks, bool, false) \
+	PO_DESC(mmapArchives, bool, false) \
 	PO_DESC(dataPathOrg, std::string, "") \
 	PO_DESC(dataPathApp, std::string, "") \
 	PO_DESC(iconPath, std::string, "") \
@@ -194,6 +211,7 @@ void Config::read(int argc, char *argv[])
 	PO_DESC(midi.reverb, bool, false) \
 	PO_DESC(SE.sourceCount, int, 6) \
 	PO_DESC(pathCache, bool, true) \
+	PO_DESC(pathCacheIndex, bool, true) \
 	PO_DESC(customScript, std::string, "") \
 	PO_DESC(useScriptNames, bool, false)
 
@@ -292,6 +310,16 @@ void Config::read(int argc, char *argv[])
 
 	SE.sourceCount = clamp(SE.sourceCount, 1, 64);
 
+	/* Nobody is watching, so render as fast as possible */
+	if (headless)
+	{
+		fullscreen = false;
+		vsync = false;
+		syncToRefreshrate = false;
+		fixedFramerate = -1;
+		frameSkip = false;
+	}
+
 	if (!dataPathOrg.empty() && !dataPathApp.empty())
 		customDataPath = prefPath(dataPathOrg.c_str(), dataPathApp.c_str());
 
@@ -33,6 +33,18 @@ struct Config
 
 	bool debugMode;
 	bool printFPS;
+	bool frameStatsOverlay;
+	std::string traceFile;
+	bool gpuTimers;
+
+	bool headless;
+	int benchmarkFrames;
+	std::string benchmarkReport;
+
+	std::string inputRecord;
+	std::string inputReplay;
+
+	bool shaderCache;
 
 	bool winResizable;
 	bool fullscreen;
@@ -54,14 +66,23 @@ struct Config
 
 	bool subImageFix;
 	bool enableBlitting;
+	bool spriteBatching;
+	int tilemapBuildMargin;
 	int maxTextureSize;
+	int texturePoolSize;
+	int bitmapCacheSize;
+	bool bitmapAtlas;
+	int textCacheSize;
+	int preloadThreads;
 
 	std::string gameFolder;
     bool copyText;
 	bool anyAltToggleFS;
 	bool enableReset;
 	bool allowSymlinks;
+	bool mmapArchives;
 	bool pathCache;
+	bool pathCacheIndex;
 
 	std::string dataPathOrg;
 	std::string dataPathApp;
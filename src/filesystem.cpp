@@ -28,10 +28,12 @@
 #include "sharedstate.h"
 #include "boost-hash.h"
 #include "debugwriter.h"
+#include "tracer.h"
 
 #include <physfs.h>
 
 #include <SDL_sound.h>
+#include <SDL_mutex.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -40,6 +42,14 @@
 #include <stack>
 #include <cctype>
 
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits.h>
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
 #ifdef __APPLE__
 #include <iconv.h>
 #endif
@@ -360,13 +370,48 @@ struct FileSystemPrivate
 	/* Maps: lower case full filepath,
 	 * To:   mixed case full filepath */
 	BoostHash<std::string, std::string> pathCache;
-	/* Maps: lower case directory path,
-	 * To:   list of lower case filenames */
-	BoostHash<std::string, std::vector<std::string> > fileLists;
+	/* Maps: lower case full filepath without extension(s),
+	 * To:   list of lower case filenames (in that directory)
+	 *       matching it, either fully or up to an extension */
+	BoostHash<std::string, std::vector<std::string> > stemIndex;
 
 	/* This is for compatibility with games that take Windows'
 	 * case insensitivity for granted */
 	bool havePathCache;
+
+	/* The cache was read from the persistent index, and is
+	 * rebuilt once on the first lookup it can't satisfy */
+	bool cacheFromIndex;
+	std::string indexDir;
+
+	/* Guards the path cache against the bitmap preloader
+	 * reading it while it is rebuilt */
+	SDL_mutex *cacheMutex;
+
+	/* Registers one file found while building the path cache */
+	void addCacheEntry(const std::string &mixedCase,
+	                   const std::string &lowerFilename)
+	{
+		std::string lowerCase = mixedCase;
+		strTolower(lowerCase);
+
+		/* Index the file under every name it could be opened
+		 * by: its full name, and every prefix of it that is
+		 * followed by an extension ('a.b.png' -> 'a', 'a.b') */
+		size_t nameStart = lowerCase.rfind('/');
+		nameStart = (nameStart == std::string::npos) ? 0 : nameStart + 1;
+
+		for (size_t i = nameStart + 1; i <= lowerCase.size(); ++i)
+		{
+			if (i < lowerCase.size() && lowerCase[i] != '.')
+				continue;
+
+			stemIndex[lowerCase.substr(0, i)].push_back(lowerFilename);
+		}
+
+		/* Add the lower -> mixed mapping of the file's full path */
+		pathCache.insert(lowerCase, mixedCase);
+	}
 };
 
 static void throwPhysfsError(const char *desc)
@@ -378,7 +423,8 @@ static void throwPhysfsError(const char *desc)
 }
 
 FileSystem::FileSystem(const char *argv0,
-                       bool allowSymlinks)
+                       bool allowSymlinks,
+                       bool mmapArchives)
 {
 	if (PHYSFS_init(argv0) == 0)
 		throwPhysfsError("Error initializing PhysFS");
@@ -392,8 +438,12 @@ FileSystem::FileSystem(const char *argv0,
 	if (er == 0)
 		throwPhysfsError("Error registering PhysFS RGSS archiver");
 
+	RGSS_setMmapEnabled(mmapArchives);
+
 	p = new FileSystemPrivate;
 	p->havePathCache = false;
+	p->cacheFromIndex = false;
+	p->cacheMutex = SDL_CreateMutex();
 
 	if (allowSymlinks)
 		PHYSFS_permitSymbolicLinks(1);
@@ -401,6 +451,7 @@ FileSystem::FileSystem(const char *argv0,
 
 FileSystem::~FileSystem()
 {
+	SDL_DestroyMutex(p->cacheMutex);
 	delete p;
 
 	if (PHYSFS_deinit() == 0)
@@ -433,20 +484,24 @@ std::string FileSystem::getPathFromCache(std::string path)
     std::transform(cachedPath.begin(), cachedPath.end(), cachedPath.begin(),
         [](unsigned char c){ return std::tolower(c); });
             
+    SDL_LockMutex(p->cacheMutex);
+
     if(p->pathCache.contains(cachedPath.c_str()))
-    {
-        return p->pathCache[cachedPath];
-    }
-    else
-    {
-        return tmpPath;
-    }
+        tmpPath = p->pathCache[cachedPath];
+
+    SDL_UnlockMutex(p->cacheMutex);
+
+    return tmpPath;
 }
 
 struct CacheEnumData
 {
 	FileSystemPrivate *p;
-	std::stack<std::vector<std::string>*> fileLists;
+
+	/* Everything that was found, kept around
+	 * for writing out the persistent index */
+	std::vector<std::string> dirs;
+	std::vector<std::pair<std::string, std::string> > files;
 
 #ifdef __APPLE__
 	iconv_t nfd2nfc;
@@ -515,37 +570,337 @@ cacheEnumCB(void *d, const char *origdir, const char *fname)
 
 	if (stat.filetype == PHYSFS_FILETYPE_DIRECTORY)
 	{
-		/* Create a new list for this directory */
-		std::vector<std::string> &list = data.p->fileLists[lowerCase];
+		data.dirs.push_back(mixedCase);
 
 		/* Iterate over its contents */
-		data.fileLists.push(&list);
 		PHYSFS_enumerate(fullPath, cacheEnumCB, d);
-		data.fileLists.pop();
 	}
 	else
 	{
-		/* Get the file list for the directory we're currently
-		 * traversing and append this filename to it */
-		std::vector<std::string> &list = *data.fileLists.top();
 		std::string lowerFilename(fname);
 		strTolower(lowerFilename);
-		list.push_back(lowerFilename);
 
-		/* Add the lower -> mixed mapping of the file's full path */
-		data.p->pathCache.insert(lowerCase, mixedCase);
+		data.p->addCacheEntry(mixedCase, lowerFilename);
+		data.files.push_back(std::make_pair(mixedCase, lowerFilename));
 	}
 
 	return PHYSFS_ENUM_OK;
 }
 
-void FileSystem::createPathCache()
+/* Persistent path cache index.
+ * Enumerating (and stat'ing) every asset of a game plus its RTPs
+ * can take seconds on slow storage, so the result is written out
+ * to the user data directory and reused on the next launch.
+ * The index is only used as long as none of the mounted archives
+ * changed (mtime/size) and none of the directories in the search
+ * path had entries added, removed or renamed (dir mtime). Mounts
+ * that can't be stat'ed (eg. mounted via SDL_RWops) can't be
+ * checked, so no index is used at all with those. It's a local
+ * cache, so everything is stored in native byte order. */
+
+#define PATH_INDEX_VER 1
+
+struct PathIndexHeader
+{
+	char magic[4];
+	uint32_t formVer;
+	uint64_t mountsHash;
+	uint32_t dirCount;
+	uint32_t fileCount;
+};
+
+static uint64_t fnv1a(const void *data, size_t size,
+                      uint64_t hash = 0xcbf29ce484222325ULL)
+{
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+struct SearchPathEntry
+{
+	std::string path;
+	bool isDir;
+	int64_t mtime;
+	int64_t size;
+};
+
+static bool statReal(const std::string &path, SearchPathEntry &out)
+{
+	struct stat st;
+
+	if (stat(path.c_str(), &st) != 0)
+		return false;
+
+	out.isDir = S_ISDIR(st.st_mode);
+	out.mtime = st.st_mtime;
+	out.size = st.st_size;
+
+	return true;
+}
+
+/* Resolves the current search path to absolute real paths.
+ * Returns false if any of the mounts couldn't be stat'ed */
+static bool getSearchPath(std::vector<SearchPathEntry> &result)
+{
+	char **list = PHYSFS_getSearchPath();
+
+	if (!list)
+		return false;
+
+	char cwd[PATH_MAX];
+	bool haveCwd = getcwd(cwd, sizeof(cwd)) != 0;
+	bool ok = true;
+
+	for (char **i = list; *i; ++i)
+	{
+		SearchPathEntry e;
+		e.path = *i;
+
+		const bool relative =
+			e.path[0] != '/' && !(e.path.size() > 1 && e.path[1] == ':');
+
+		if (relative && haveCwd)
+			e.path = std::string(cwd) + "/" + e.path;
+
+		/* Mounted via SDL_RWops or gone */
+		if ((relative && !haveCwd) || !statReal(e.path, e))
+		{
+			e.isDir = false;
+			e.mtime = e.size = -1;
+			ok = false;
+		}
+
+		result.push_back(e);
+	}
+
+	PHYSFS_freeList(list);
+
+	return ok;
+}
+
+/* Fingerprint of 'dir' in all directory mounts,
+ * changes when an entry is added/removed/renamed */
+static uint64_t dirFingerprint(const std::vector<SearchPathEntry> &mounts,
+                               const std::string &dir)
+{
+	uint64_t hash = fnv1a(dir.c_str(), dir.size());
+
+	for (size_t i = 0; i < mounts.size(); ++i)
+	{
+		if (!mounts[i].isDir)
+			continue;
+
+		SearchPathEntry e;
+		int64_t mtime = -1;
+
+		if (statReal(mounts[i].path + "/" + dir, e))
+			mtime = e.mtime;
+
+		hash = fnv1a(&i, sizeof(i), hash);
+		hash = fnv1a(&mtime, sizeof(mtime), hash);
+	}
+
+	return hash;
+}
+
+static void putString(std::string &out, const std::string &str)
+{
+	uint32_t len = str.size();
+	out.append(reinterpret_cast<const char*>(&len), sizeof(len));
+	out.append(str);
+}
+
+struct IndexReader
+{
+	const std::string &buf;
+	size_t pos;
+
+	IndexReader(const std::string &buf)
+	    : buf(buf), pos(0)
+	{}
+
+	bool read(void *dst, size_t size)
+	{
+		if (buf.size() - pos < size)
+			return false;
+
+		memcpy(dst, &buf[pos], size);
+		pos += size;
+
+		return true;
+	}
+
+	bool readString(std::string &str)
+	{
+		uint32_t len;
+
+		if (!read(&len, sizeof(len)) || buf.size() - pos < len)
+			return false;
+
+		str.assign(buf, pos, len);
+		pos += len;
+
+		return true;
+	}
+};
+
+static bool readPathIndex(FileSystemPrivate *p, const char *path,
+                          const std::vector<SearchPathEntry> &mounts,
+                          uint64_t mountsHash)
+{
+	std::string buf;
+
+	/* Slurp in the entire index with one read */
+	if (!readFile(path, buf))
+		return false;
+
+	IndexReader rd(buf);
+	PathIndexHeader hd;
+
+	if (!rd.read(&hd, sizeof(hd)))
+		return false;
+
+	if (memcmp(hd.magic, "MKPI", 4) || hd.formVer != PATH_INDEX_VER)
+		return false;
+
+	if (hd.mountsHash != mountsHash)
+		return false;
+
+	for (uint32_t i = 0; i < hd.dirCount; ++i)
+	{
+		uint64_t fingerprint;
+		std::string dir;
+
+		if (!rd.read(&fingerprint, sizeof(fingerprint)) || !rd.readString(dir))
+			return false;
+
+		if (dirFingerprint(mounts, dir) != fingerprint)
+			return false;
+	}
+
+	std::vector<std::pair<std::string, std::string> > files(hd.fileCount);
+
+	for (uint32_t i = 0; i < hd.fileCount; ++i)
+		if (!rd.readString(files[i].first) || !rd.readString(files[i].second))
+			return false;
+
+	for (size_t i = 0; i < files.size(); ++i)
+		p->addCacheEntry(files[i].first, files[i].second);
+
+	return true;
+}
+
+static void writePathIndex(const CacheEnumData &data, const char *path,
+                           const std::vector<SearchPathEntry> &mounts,
+                           uint64_t mountsHash)
 {
+	PathIndexHeader hd;
+	memcpy(hd.magic, "MKPI", 4);
+	hd.formVer = PATH_INDEX_VER;
+	hd.mountsHash = mountsHash;
+	hd.dirCount = data.dirs.size();
+	hd.fileCount = data.files.size();
+
+	std::string buf(reinterpret_cast<const char*>(&hd), sizeof(hd));
+
+	for (size_t i = 0; i < data.dirs.size(); ++i)
+	{
+		uint64_t fingerprint = dirFingerprint(mounts, data.dirs[i]);
+		buf.append(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint));
+		putString(buf, data.dirs[i]);
+	}
+
+	for (size_t i = 0; i < data.files.size(); ++i)
+	{
+		putString(buf, data.files[i].first);
+		putString(buf, data.files[i].second);
+	}
+
+	FILE *f = fopen(path, "wb");
+
+	if (!f)
+		return;
+
+	if (fwrite(buf.data(), 1, buf.size(), f) < buf.size())
+		Debug() << "Failed to write path cache index" << path;
+
+	fclose(f);
+}
+
+/* Fills the (cleared) path cache, from the persistent index if
+ * 'readIndex' is set and it's still valid. Called with the cache
+ * mutex held */
+static void buildPathCache(FileSystemPrivate *p, bool readIndex)
+{
+	std::vector<SearchPathEntry> mounts;
+	bool useIndex = !p->indexDir.empty();
+
+	if (!getSearchPath(mounts) && useIndex)
+	{
+		Debug() << "Not using path cache index, some mounts can't be checked for changes";
+		useIndex = false;
+	}
+
+	/* The index file name is derived from the search path (so
+	 * games sharing a data directory don't clobber each other),
+	 * while the hash stored inside also covers archive changes */
+	uint64_t pathsHash = fnv1a(0, 0);
+	uint64_t mountsHash = fnv1a(0, 0);
+
+	for (size_t i = 0; i < mounts.size(); ++i)
+	{
+		const SearchPathEntry &e = mounts[i];
+		pathsHash = fnv1a(e.path.c_str(), e.path.size() + 1, pathsHash);
+		mountsHash = fnv1a(e.path.c_str(), e.path.size() + 1, mountsHash);
+		mountsHash = fnv1a(&e.isDir, sizeof(e.isDir), mountsHash);
+
+		/* A directory's own mtime is covered by the root fingerprint */
+		if (e.isDir)
+			continue;
+
+		mountsHash = fnv1a(&e.mtime, sizeof(e.mtime), mountsHash);
+		mountsHash = fnv1a(&e.size, sizeof(e.size), mountsHash);
+	}
+
+	char indexPath[1024];
+	snprintf(indexPath, sizeof(indexPath), "%spathcache-%016llx.mkxp",
+	         p->indexDir.c_str(), (unsigned long long) pathsHash);
+
+	p->pathCache.clear();
+	p->stemIndex.clear();
+	p->havePathCache = true;
+
+	if (useIndex && readIndex && readPathIndex(p, indexPath, mounts, mountsHash))
+	{
+		p->cacheFromIndex = true;
+		return;
+	}
+
+	p->cacheFromIndex = false;
+
 	CacheEnumData data(p);
-	data.fileLists.push(&p->fileLists[""]);
+	data.dirs.push_back("");
 	PHYSFS_enumerate("", cacheEnumCB, &data);
 
-	p->havePathCache = true;
+	if (useIndex)
+		writePathIndex(data, indexPath, mounts, mountsHash);
+}
+
+void FileSystem::createPathCache(const std::string &indexDir)
+{
+	SDL_LockMutex(p->cacheMutex);
+
+	p->indexDir = indexDir;
+	buildPathCache(p, true);
+
+	SDL_UnlockMutex(p->cacheMutex);
 }
 
 struct FontSetsCBData
@@ -633,6 +988,9 @@ struct OpenReadEnumData
 	 * (used with path cache) */
 	BoostHash<std::string, std::string> *pathTrans;
 
+	/* Receives the path of the successfully read file */
+	std::string *foundPath;
+
 	/* Number of files we've attempted to read and parse */
 	size_t matchCount;
 	bool stopSearching;
@@ -643,9 +1001,11 @@ struct OpenReadEnumData
 
 	OpenReadEnumData(FileSystem::OpenHandler &handler,
 	                 const char *filename, size_t filenameN,
-	                 BoostHash<std::string, std::string> *pathTrans)
+	                 BoostHash<std::string, std::string> *pathTrans,
+	                 std::string *foundPath)
 	    : handler(handler), filename(filename), filenameN(filenameN),
-	      pathTrans(pathTrans), matchCount(0), stopSearching(false),
+	      pathTrans(pathTrans), foundPath(foundPath),
+	      matchCount(0), stopSearching(false),
 	      physfsError(0)
 	{}
 };
@@ -683,8 +1043,9 @@ openReadEnumCB(void *d, const char *dirpath, const char *filename)
 		return PHYSFS_ENUM_STOP;
 
 	/* If the path cache is active, translate from lower case
-	 * to mixed case path */
-	if (data.pathTrans)
+	 * to mixed case path. Only look up existing keys so that
+	 * concurrent readers never modify the hash */
+	if (data.pathTrans && data.pathTrans->contains(fullPath))
 		fullPath = (*data.pathTrans)[fullPath].c_str();
 
 	PHYSFS_File *phys = PHYSFS_openRead(fullPath);
@@ -705,14 +1066,77 @@ openReadEnumCB(void *d, const char *dirpath, const char *filename)
 	const char *ext = findExt(filename);
 
 	if (data.handler.tryRead(data.ops, ext))
+	{
 		data.stopSearching = true;
 
+		if (data.foundPath)
+			*data.foundPath = fullPath;
+	}
+
 	++data.matchCount;
 	return PHYSFS_ENUM_OK;
 }
 
-void FileSystem::openRead(OpenHandler &handler, const char *filename)
+/* Only looks at the files that can possibly match. The
+ * candidates are copied out so that the cache isn't held
+ * locked while they are read */
+static void openReadCached(FileSystemPrivate *p, OpenReadEnumData &data,
+                           const std::string &stem, const char *dir)
 {
+	std::vector<std::string> fileList;
+	BoostHash<std::string, std::string> pathTrans;
+
+	SDL_LockMutex(p->cacheMutex);
+
+	if (p->stemIndex.contains(stem))
+	{
+		fileList = p->stemIndex[stem];
+
+		for (size_t i = 0; i < fileList.size(); ++i)
+		{
+			std::string fullPath = *dir ? std::string(dir) + "/" + fileList[i]
+			                            : fileList[i];
+
+			if (p->pathCache.contains(fullPath))
+				pathTrans.insert(fullPath, p->pathCache[fullPath]);
+		}
+	}
+
+	SDL_UnlockMutex(p->cacheMutex);
+
+	data.pathTrans = &pathTrans;
+
+	for (size_t i = 0; i < fileList.size(); ++i)
+		openReadEnumCB(&data, dir, fileList[i].c_str());
+
+	data.pathTrans = 0;
+}
+
+/* Returns true if the cache was rebuilt */
+static bool rebuildStaleCache(FileSystemPrivate *p)
+{
+	bool rebuild;
+
+	SDL_LockMutex(p->cacheMutex);
+
+	rebuild = p->cacheFromIndex;
+
+	if (rebuild)
+	{
+		Debug() << "Path cache index is out of date, rebuilding it";
+		buildPathCache(p, false);
+	}
+
+	SDL_UnlockMutex(p->cacheMutex);
+
+	return rebuild;
+}
+
+void FileSystem::openRead(OpenHandler &handler, const char *filename,
+                          std::string *foundPath)
+{
+	TRACE_SCOPE("FileSystem::openRead");
+
     std::string fileString = filename;
     fileString = normalizePath(fileString);
     const char *nfilename = fileString.c_str();
@@ -724,6 +1148,9 @@ void FileSystem::openRead(OpenHandler &handler, const char *filename)
 		for (size_t i = 0; i < len; ++i)
 			buffer[i] = tolower(buffer[i]);
 
+	/* Full lower case path, used as stem index key */
+	const std::string stem(buffer, len);
+
 	/* Find the deliminator separating directory and file name */
 	for (delim = buffer + len; delim > buffer; --delim)
 		if (*delim == '/')
@@ -744,16 +1171,16 @@ void FileSystem::openRead(OpenHandler &handler, const char *filename)
 	}
 
 	OpenReadEnumData data(handler, file, len + buffer - delim - !root,
-	                      p->havePathCache ? &p->pathCache : 0);
+	                      0, foundPath);
 
 	if (p->havePathCache)
 	{
-		/* Get the list of files contained in this directory
-		 * and manually iterate over them */
-		const std::vector<std::string> &fileList = p->fileLists[dir];
+		openReadCached(p, data, stem, dir);
 
-		for (size_t i = 0; i < fileList.size(); ++i)
-			openReadEnumCB(&data, dir, fileList[i].c_str());
+		/* A stale index may be missing files that were
+		 * added in ways it can't detect, rebuild it once */
+		if (data.matchCount == 0 && !data.physfsError && rebuildStaleCache(p))
+			openReadCached(p, data, stem, dir);
 	}
 	else
 	{
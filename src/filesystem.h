@@ -32,13 +32,16 @@ class FileSystem
 {
 public:
 	FileSystem(const char *argv0,
-	           bool allowSymlinks);
+	           bool allowSymlinks,
+	           bool mmapArchives);
 	~FileSystem();
 
 	void addPath(const char *path);
 
-	/* Call these after the last 'addPath()' */
-	void createPathCache();
+	/* Call these after the last 'addPath()'.
+	 * If 'indexDir' is non-empty, a persistent index of the
+	 * cache is read from/written to it to speed up startup */
+	void createPathCache(const std::string &indexDir = std::string());
 
 	/* Scans "Fonts/" and creates inventory of
 	 * available font assets */
@@ -57,8 +60,11 @@ public:
 		virtual bool tryRead(SDL_RWops &ops, const char *ext) = 0;
 	};
 
+	/* If 'foundPath' is non-null, it receives the full path
+	 * of the file that was accepted by the handler */
 	void openRead(OpenHandler &handler,
-	              const char *filename);
+	              const char *filename,
+	              std::string *foundPath = 0);
 
 	/* Circumvents extension supplementing */
 	void openReadRaw(SDL_RWops &ops,
@@ -0,0 +1,245 @@
+/*
+** framestats.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "framestats.h"
+
+#include "sdl-util.h"
+
+#include <SDL_timer.h>
+
+#include <algorithm>
+#include <string>
+#include <stdio.h>
+
+const int FrameStats::historySize;
+
+static FrameStats::Summary summarize(const std::vector<double> &history, int count)
+{
+	FrameStats::Summary sum = { 0, 0, 0, 0 };
+
+	if (count == 0)
+		return sum;
+
+	/* Order doesn't matter here; the ring only
+	 * wraps once all slots have been filled */
+	std::vector<double> times(history.begin(), history.begin() + count);
+
+	double total = 0;
+
+	for (size_t i = 0; i < times.size(); ++i)
+		total += times[i];
+
+	sum.avg = total / count;
+	sum.min = *std::min_element(times.begin(), times.end());
+	sum.max = *std::max_element(times.begin(), times.end());
+
+	size_t p99 = (count * 99 + 99) / 100 - 1;
+	std::nth_element(times.begin(), times.begin() + p99, times.end());
+	sum.p99 = times[p99];
+
+	return sum;
+}
+
+FrameStats::FrameStats()
+    : frameEnd(SDL_GetPerformanceCounter()),
+      lastMark(frameEnd),
+      inFrame(false),
+      firstFrameStart(0),
+      total(0),
+      head(0),
+      count(0),
+      gpuHead(0),
+      gpuCount(0),
+      tickFreqMS(SDL_GetPerformanceFrequency() / 1000.0)
+{
+	for (int i = 0; i < PhaseCount; ++i)
+	{
+		current[i] = 0;
+		history[i].resize(historySize);
+	}
+
+	for (int i = 0; i < GpuTimer::CategoryCount; ++i)
+		gpuHistory[i].resize(historySize);
+}
+
+void FrameStats::beginFrame()
+{
+	for (int i = 0; i < PhaseCount; ++i)
+		current[i] = 0;
+
+	inFrame = true;
+	lastMark = frameEnd;
+
+	if (total == 0)
+		firstFrameStart = frameEnd;
+
+	mark(Script);
+}
+
+void FrameStats::mark(Phase phase)
+{
+	if (!inFrame)
+		return;
+
+	uint64_t now = SDL_GetPerformanceCounter();
+	current[phase] += (now - lastMark) / tickFreqMS;
+	lastMark = now;
+}
+
+void FrameStats::endFrame()
+{
+	frameEnd = SDL_GetPerformanceCounter();
+
+	if (!inFrame)
+		return;
+
+	inFrame = false;
+
+	for (int i = 0; i < PhaseCount; ++i)
+		history[i][head] = current[i];
+
+	head = (head + 1) % historySize;
+	count = std::min(count + 1, historySize);
+	++total;
+}
+
+int FrameStats::frameCount() const
+{
+	return count;
+}
+
+int FrameStats::totalFrames() const
+{
+	return total;
+}
+
+FrameStats::Summary FrameStats::getSummary(Phase phase) const
+{
+	return summarize(history[phase], count);
+}
+
+double FrameStats::getTime(int age, Phase phase) const
+{
+	if (age < 0 || age >= count)
+		return 0;
+
+	int index = (head - 1 - age + historySize) % historySize;
+
+	return history[phase][index];
+}
+
+const char *FrameStats::phaseName(Phase phase)
+{
+	static const char *names[] =
+	{
+		"script",
+		"prepare_draw",
+		"composite",
+		"present",
+		"delay",
+		"swap"
+	};
+
+	return names[phase];
+}
+
+void FrameStats::recordGpu(const double *times)
+{
+	for (int i = 0; i < GpuTimer::CategoryCount; ++i)
+		gpuHistory[i][gpuHead] = times[i];
+
+	gpuHead = (gpuHead + 1) % historySize;
+	gpuCount = std::min(gpuCount + 1, historySize);
+}
+
+int FrameStats::gpuFrameCount() const
+{
+	return gpuCount;
+}
+
+FrameStats::Summary FrameStats::getGpuSummary(GpuTimer::Category category) const
+{
+	return summarize(gpuHistory[category], gpuCount);
+}
+
+static void appendSummary(std::string &out, const char *name,
+                          const FrameStats::Summary &sum, bool last)
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf),
+	         "    \"%s\": { \"min\": %.3f, \"avg\": %.3f, \"p99\": %.3f, \"max\": %.3f }%s\n",
+	         name, sum.min, sum.avg, sum.p99, sum.max, last ? "" : ",");
+	out += buf;
+}
+
+bool FrameStats::writeReport(const char *filename) const
+{
+	const double seconds = (frameEnd - firstFrameStart) / (tickFreqMS * 1000);
+
+	/* Whole frame times, for the 'frame' summary */
+	std::vector<double> frameTimes(historySize, 0);
+
+	for (int i = 0; i < PhaseCount; ++i)
+		for (int j = 0; j < count; ++j)
+			frameTimes[j] += history[i][j];
+
+	char buf[256];
+	snprintf(buf, sizeof(buf),
+	         "{\n  \"frames\": %d,\n  \"seconds\": %.3f,\n  \"fps\": %.2f,\n"
+	         "  \"window\": %d,\n  \"phases\": {\n",
+	         total, seconds, seconds > 0 ? total / seconds : 0, count);
+
+	std::string out = buf;
+
+	appendSummary(out, "frame", summarize(frameTimes, count), false);
+
+	for (int i = 0; i < PhaseCount; ++i)
+		appendSummary(out, phaseName((Phase) i), getSummary((Phase) i), i == PhaseCount-1);
+
+	out += "  }";
+
+	if (gpuCount > 0)
+	{
+		snprintf(buf, sizeof(buf), ",\n  \"gpu_window\": %d,\n  \"gpu\": {\n", gpuCount);
+		out += buf;
+
+		for (int i = 0; i < GpuTimer::CategoryCount; ++i)
+		{
+			GpuTimer::Category cat = (GpuTimer::Category) i;
+			appendSummary(out, GpuTimer::categoryName(cat), getGpuSummary(cat),
+			              i == GpuTimer::CategoryCount-1);
+		}
+
+		out += "  }";
+	}
+
+	out += "\n}\n";
+
+	SDL_RWops *ops = RWFromFile(filename, "wb");
+
+	if (!ops)
+		return false;
+
+	size_t writ = SDL_RWwrite(ops, out.c_str(), 1, out.size());
+	SDL_RWclose(ops);
+
+	return writ == out.size();
+}
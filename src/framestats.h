@@ -0,0 +1,118 @@
+/*
+** framestats.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include "gputimer.h"
+
+#include <stdint.h>
+#include <vector>
+
+/* Records where the time of each of the last 'historySize'
+ * frames went. A frame starts when the script calls
+ * Graphics.update; everything since the previous frame's
+ * end is counted as script execution. The remaining phases
+ * are marked in the order they happen while rendering */
+class FrameStats
+{
+public:
+	enum Phase
+	{
+		Script,
+		PrepareDraw,
+		Composite,
+		Present,
+		Delay,
+		Swap,
+
+		PhaseCount
+	};
+
+	/* All times in milliseconds */
+	struct Summary
+	{
+		double min;
+		double avg;
+		double p99;
+		double max;
+	};
+
+	FrameStats();
+
+	void beginFrame();
+
+	/* Accounts the time since the previous mark to 'phase'.
+	 * Does nothing outside of a frame */
+	void mark(Phase phase);
+
+	void endFrame();
+
+	/* Number of recorded frames, at most 'historySize' */
+	int frameCount() const;
+
+	/* Number of frames since startup */
+	int totalFrames() const;
+
+	Summary getSummary(Phase phase) const;
+
+	/* Time 'phase' took in the 'age'th most recent frame */
+	double getTime(int age, Phase phase) const;
+
+	static const char *phaseName(Phase phase);
+
+	/* GPU time per category of one frame, reported by
+	 * the GpuTimer a few frames after it was rendered */
+	void recordGpu(const double *times);
+
+	/* Number of frames with GPU times, at most 'historySize' */
+	int gpuFrameCount() const;
+
+	Summary getGpuSummary(GpuTimer::Category category) const;
+
+	/* Writes the totals and all summaries as JSON */
+	bool writeReport(const char *filename) const;
+
+	static const int historySize = 300;
+
+private:
+	uint64_t frameEnd;
+	uint64_t lastMark;
+	bool inFrame;
+
+	uint64_t firstFrameStart;
+	int total;
+
+	double current[PhaseCount];
+
+	/* Ring buffer of 'historySize' frames */
+	std::vector<double> history[PhaseCount];
+	int head;
+	int count;
+
+	std::vector<double> gpuHistory[GpuTimer::CategoryCount];
+	int gpuHead;
+	int gpuCount;
+
+	const double tickFreqMS;
+};
+
+#endif // FRAMESTATS_H
@@ -95,8 +95,9 @@ void initGLFunctions()
 		ver += glesPrefixN;
 	}
 
-	/* Assume single digit */
+	/* Assume single digits */
 	int glMajor = *ver - '0';
+	int glMinor = (ver[1] == '.') ? ver[2] - '0' : 0;
 
 	if (glMajor < 2)
 		throw EXC("At least OpenGL (ES) 2.0 is required");
@@ -184,6 +185,52 @@ void initGLFunctions()
 		GL_GREMEMDY_FUN;
 	}
 
+	/* Async readback entrypoints */
+	if ((gles && glMajor >= 3) || (!gles && glMajor >= 3 && HAVE_EXT(ARB_sync)))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+		GL_ASYNC_READ_FUN;
+		gl.async_readback = true;
+	}
+
+	/* Timer query entrypoints (core since 3.3) */
+	if (!gles && (glMajor > 3 || (glMajor == 3 && glMinor >= 3) ||
+	              HAVE_EXT(ARB_timer_query)))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+		GL_TIMER_QUERY_FUN;
+		gl.timer_query = true;
+	}
+	else if (gles && HAVE_EXT(EXT_disjoint_timer_query))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX "EXT"
+		GL_TIMER_QUERY_FUN;
+		gl.timer_query = true;
+		gl.timer_disjoint = true;
+	}
+
+	/* Program binary entrypoints (core since 4.1) */
+	if ((gles && glMajor >= 3) ||
+	    (!gles && (glMajor > 4 || (glMajor == 4 && glMinor >= 1) ||
+	               HAVE_EXT(ARB_get_program_binary))))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+		GL_PROGRAM_BINARY_FUN;
+		GL_PROGRAM_BINARY_HINT_FUN;
+		gl.program_binary = true;
+	}
+	else if (gles && HAVE_EXT(OES_get_program_binary))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX "OES"
+		GL_PROGRAM_BINARY_FUN;
+		gl.program_binary = true;
+	}
+
 	/* Misc caps */
 	if (!gles || glMajor >= 3 || HAVE_EXT(EXT_unpack_subimage))
 		gl.unpack_subimage = true;
@@ -0,0 +1,215 @@
+/*
+** gputimer.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gputimer.h"
+
+#include "framestats.h"
+#include "gl-fun.h"
+#include "debugwriter.h"
+
+#include <vector>
+
+/* Frames whose queries may be in flight at the same time */
+#define FRAME_SLOTS 3
+
+struct FrameSlot
+{
+	/* Grows to the highest query count seen in a frame */
+	std::vector<GLuint> queries;
+	std::vector<int> categories;
+	size_t used;
+
+	FrameSlot()
+	    : used(0)
+	{}
+};
+
+struct GpuTimerPrivate
+{
+	bool enabled;
+
+	FrameSlot slots[FRAME_SLOTS];
+	int current;
+
+	/* False if the current slot's results
+	 * weren't available yet at frame start */
+	bool measuring;
+
+	std::vector<int> stack;
+
+	/* Category of the running query, -1 if none. When
+	 * returning to an 'Other' parent (the screen or a
+	 * viewport), the query keeps running, so consecutive
+	 * elements of the same category share one query */
+	int running;
+
+	GpuTimerPrivate(bool enabled)
+	    : enabled(enabled),
+	      current(0),
+	      measuring(true),
+	      running(-1)
+	{}
+
+	void switchTo(int category)
+	{
+		if (category == running)
+			return;
+
+		if (running >= 0)
+			gl.EndQuery(GL_TIME_ELAPSED);
+
+		running = -1;
+
+		if (category < 0 || !measuring)
+			return;
+
+		FrameSlot &slot = slots[current];
+
+		if (slot.used == slot.queries.size())
+		{
+			GLuint query;
+			gl.GenQueries(1, &query);
+
+			slot.queries.push_back(query);
+			slot.categories.push_back(0);
+		}
+
+		slot.categories[slot.used] = category;
+		gl.BeginQuery(GL_TIME_ELAPSED, slot.queries[slot.used++]);
+
+		running = category;
+	}
+
+	/* Returns false if the results aren't available yet */
+	bool collect(FrameSlot &slot, FrameStats &stats)
+	{
+		GLuint available = 0;
+		gl.GetQueryObjectuiv(slot.queries[slot.used-1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (!available)
+			return false;
+
+		GLint disjoint = 0;
+
+		if (gl.timer_disjoint)
+			gl.GetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+		if (!disjoint)
+		{
+			double times[GpuTimer::CategoryCount] = { 0 };
+
+			for (size_t i = 0; i < slot.used; ++i)
+			{
+				uint64_t ns = 0;
+				gl.GetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &ns);
+
+				times[slot.categories[i]] += ns / 1000000.0;
+			}
+
+			stats.recordGpu(times);
+		}
+
+		slot.used = 0;
+
+		return true;
+	}
+};
+
+GpuTimer::GpuTimer(bool enabled)
+{
+	if (enabled && !gl.timer_query)
+	{
+		Debug() << "GPU timers requested, but timer queries are not supported";
+		enabled = false;
+	}
+
+	p = new GpuTimerPrivate(enabled);
+}
+
+GpuTimer::~GpuTimer()
+{
+	for (int i = 0; i < FRAME_SLOTS; ++i)
+		if (!p->slots[i].queries.empty())
+			gl.DeleteQueries(p->slots[i].queries.size(), &p->slots[i].queries[0]);
+
+	delete p;
+}
+
+bool GpuTimer::isEnabled() const
+{
+	return p->enabled;
+}
+
+void GpuTimer::push(Category category)
+{
+	p->stack.push_back(category);
+	p->switchTo(category);
+}
+
+void GpuTimer::pop()
+{
+	p->stack.pop_back();
+
+	if (p->stack.empty())
+		p->switchTo(-1);
+	else if (p->stack.back() != Other)
+		p->switchTo(p->stack.back());
+}
+
+void GpuTimer::endFrame(FrameStats &stats)
+{
+	if (!p->enabled)
+		return;
+
+	p->stack.clear();
+	p->switchTo(-1);
+
+	p->current = (p->current + 1) % FRAME_SLOTS;
+
+	/* Oldest frame first; later frames
+	 * can't be done before earlier ones */
+	for (int i = 0; i < FRAME_SLOTS; ++i)
+	{
+		FrameSlot &slot = p->slots[(p->current + i) % FRAME_SLOTS];
+
+		if (slot.used > 0 && !p->collect(slot, stats))
+			break;
+	}
+
+	/* Skip this frame if the slot is still in use */
+	p->measuring = (p->slots[p->current].used == 0);
+}
+
+const char *GpuTimer::categoryName(Category category)
+{
+	static const char *names[] =
+	{
+		"sprites",
+		"planes",
+		"windows",
+		"tilemaps",
+		"viewport_effects",
+		"transitions",
+		"other"
+	};
+
+	return names[category];
+}
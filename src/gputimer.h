@@ -0,0 +1,88 @@
+/*
+** gputimer.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+class FrameStats;
+struct GpuTimerPrivate;
+
+/* Measures the GPU time spent per category of scene element
+ * with timer queries. Categories nest (a viewport's sprites
+ * are drawn while the viewport is being drawn); time is
+ * always accounted to the innermost one. Query results are
+ * read a few frames later, so the GPU is never waited on */
+class GpuTimer
+{
+public:
+	enum Category
+	{
+		Sprites,
+		Planes,
+		Windows,
+		Tilemaps,
+		ViewportEffects,
+		Transitions,
+		Other,
+
+		CategoryCount
+	};
+
+	/* Only enabled if the driver supports timer queries */
+	GpuTimer(bool enabled);
+	~GpuTimer();
+
+	bool isEnabled() const;
+
+	void push(Category category);
+	void pop();
+
+	/* Closes the current frame, and passes the times
+	 * of earlier frames that became available to 'stats' */
+	void endFrame(FrameStats &stats);
+
+	static const char *categoryName(Category category);
+
+private:
+	GpuTimerPrivate *p;
+};
+
+struct GpuTimerScope
+{
+	GpuTimer &timer;
+	const bool active;
+
+	GpuTimerScope(GpuTimer &timer, GpuTimer::Category category)
+	    : timer(timer),
+	      active(timer.isEnabled())
+	{
+		if (active)
+			timer.push(category);
+	}
+
+	~GpuTimerScope()
+	{
+		if (active)
+			timer.pop();
+	}
+};
+
+#endif // GPUTIMER_H
@@ -39,6 +39,11 @@
 #include "intrulist.h"
 #include "binding.h"
 #include "debugwriter.h"
+#include "screenshotwriter.h"
+#include "framestats.h"
+#include "tracer.h"
+#include "quadarray.h"
+#include "gputimer.h"
 
 #include <SDL.h>
 #include <SDL_video.h>
@@ -135,8 +140,9 @@ private:
 class ScreenScene : public Scene
 {
 public:
-	ScreenScene(int width, int height)
-	    : pp(width, height)
+	ScreenScene(int width, int height, FrameStats &stats)
+	    : pp(width, height),
+	      stats(stats)
 	{
 		updateReso(width, height);
 
@@ -151,6 +157,12 @@ public:
 
 		shState->prepareDraw();
 
+		stats.mark(FrameStats::PrepareDraw);
+
+		/* Elements account their own time; this
+		 * covers clearing and the brightness quad */
+		GpuTimerScope gpuScope(shState->gpuTimer(), GpuTimer::Other);
+
 		pp.startRender();
 
 		glState.viewport.set(IntRect(0, 0, w, h));
@@ -180,6 +192,8 @@ public:
 		const bool colorEffect    = c.w > 0;
 		const bool flashEffect    = f.w > 0;
 
+		GpuTimerScope gpuScope(shState->gpuTimer(), GpuTimer::ViewportEffects);
+
 		if (toneGrayEffect)
 		{
 			pp.swapRender();
@@ -315,6 +329,8 @@ private:
 
 	Quad brightnessQuad;
 	bool brightEffect;
+
+	FrameStats &stats;
 };
 
 /* Nanoseconds per second */
@@ -465,6 +481,9 @@ struct GraphicsPrivate
 	 * is blitted inside the game window */
 	Vec2i scOffset;
 
+	/* Referenced by 'screen', so it comes first */
+	FrameStats frameStats;
+
 	ScreenScene screen;
 	RGSSThreadData *threadData;
 	SDL_GLContext glCtx;
@@ -482,6 +501,15 @@ struct GraphicsPrivate
 	TEXFBO frozenScene;
 	Quad screenQuad;
 
+	ScreenshotWriter screenshots;
+
+	/* Created on first use */
+	ColorQuadArray *statsQuads;
+
+	/* Set once 'benchmarkFrames' frames have been rendered */
+	bool benchmarkDone;
+	bool reportWritten;
+
 	/* Global list of all live Disposables
 	 * (disposed on reset) */
 	IntruList<Disposable> dispList;
@@ -490,7 +518,7 @@ struct GraphicsPrivate
 	    : scRes(DEF_SCREEN_W, DEF_SCREEN_H),
 	      scSize(scRes),
 	      winSize(rtData->config.defScreenW, rtData->config.defScreenH),
-	      screen(scRes.x, scRes.y),
+	      screen(scRes.x, scRes.y, frameStats),
 	      threadData(rtData),
 	      glCtx(SDL_GL_GetCurrentContext()),
 	      frameRate(DEF_FRAMERATE),
@@ -499,7 +527,10 @@ struct GraphicsPrivate
           frameSkipIndex(0),
           fastForward(false),
 	      fpsLimiter(frameRate),
-	      frozen(false)
+	      frozen(false),
+	      statsQuads(0),
+	      benchmarkDone(false),
+	      reportWritten(false)
 	{
 		recalculateScreenSize(rtData);
 		updateScreenResoRatio(rtData);
@@ -517,6 +548,7 @@ struct GraphicsPrivate
 
 	~GraphicsPrivate()
 	{
+		delete statsQuads;
 		TEXFBO::fini(frozenScene);
 	}
 
@@ -580,10 +612,51 @@ struct GraphicsPrivate
 		scriptBinding->terminate();
 	}
 
+	void writeReport()
+	{
+		const std::string &path = threadData->config.benchmarkReport;
+
+		if (reportWritten || path.empty())
+			return;
+
+		reportWritten = true;
+
+		if (!frameStats.writeReport(path.c_str()))
+			Debug() << "Failed to write timing report to" << path;
+	}
+
+	void endFrame()
+	{
+		frameStats.endFrame();
+
+		const int limit = threadData->config.benchmarkFrames;
+
+		if (limit <= 0 || benchmarkDone || frameStats.totalFrames() < limit)
+			return;
+
+		/* Report before the frames it takes the script to
+		 * notice the shutdown request get counted too */
+		benchmarkDone = true;
+		writeReport();
+
+		Debug() << "Benchmark finished after" << limit << "frames";
+		threadData->ethread->requestTerminate();
+	}
+
 	void swapGLBuffer()
 	{
 		fpsLimiter.delay();
+		frameStats.mark(FrameStats::Delay);
+
+		shState->gpuTimer().endFrame(frameStats);
+
 		SDL_GL_SwapWindow(threadData->window);
+		frameStats.mark(FrameStats::Swap);
+
+		/* Also called outside of Graphics.update (eg. during
+		 * transitions), where this only restarts the script
+		 * phase timer */
+		endFrame();
 
 		++frameCount;
 
@@ -608,9 +681,71 @@ struct GraphicsPrivate
 	}
 
 
+	/* Stacked bars of the recent frame times along the bottom
+	 * of the window, newest on the right. A line marks the
+	 * time budget of one frame */
+	void drawStatsOverlay()
+	{
+		static const Vec4 phaseColors[FrameStats::PhaseCount] =
+		{
+			Vec4(0.2, 0.6, 1.0, 0.8), /* Script */
+			Vec4(1.0, 0.6, 0.2, 0.8), /* PrepareDraw */
+			Vec4(0.2, 0.9, 0.3, 0.8), /* Composite */
+			Vec4(0.9, 0.2, 0.9, 0.8), /* Present */
+			Vec4(0.5, 0.5, 0.5, 0.8), /* Delay */
+			Vec4(1.0, 0.9, 0.2, 0.8)  /* Swap */
+		};
+
+		const int barWidth = 3;
+		const int budgetHeight = 64;
+		const float pxPerMS = budgetHeight / (1000.f / frameRate);
+
+		const int frames = std::min(frameStats.frameCount(), winSize.x / barWidth);
+
+		if (!statsQuads)
+			statsQuads = new ColorQuadArray;
+
+		statsQuads->resize(frames * FrameStats::PhaseCount + 1);
+		Vertex *vert = &statsQuads->vertices[0];
+
+		for (int i = 0; i < frames; ++i)
+		{
+			const float x = winSize.x - (i+1) * barWidth;
+			float y = 0;
+
+			for (int j = 0; j < FrameStats::PhaseCount; ++j)
+			{
+				const float h = frameStats.getTime(i, (FrameStats::Phase) j) * pxPerMS;
+
+				Quad::setPosRect(vert, FloatRect(x, y, barWidth - 1, h));
+				Quad::setColor(vert, phaseColors[j]);
+				vert += 4;
+
+				y += h;
+			}
+		}
+
+		Quad::setPosRect(vert, FloatRect(0, budgetHeight, winSize.x, 1));
+		Quad::setColor(vert, Vec4(1, 1, 1, 0.6));
+
+		statsQuads->commit();
+
+		glState.viewport.pushSet(IntRect(0, 0, winSize.x, winSize.y));
+
+		SimpleColorShader &shader = shState->shaders().simpleColor;
+		shader.bind();
+		shader.applyViewportProj();
+		shader.setTranslation(Vec2i());
+
+		statsQuads->draw();
+
+		glState.viewport.pop();
+	}
+
 	void redrawScreen()
 	{
 		screen.composite();
+		frameStats.mark(FrameStats::Composite);
 
 		GLMeta::blitBeginScreen(winSize);
 		GLMeta::blitSource(screen.getPP().frontBuffer());
@@ -620,6 +755,11 @@ struct GraphicsPrivate
 
 		GLMeta::blitEnd();
 
+		if (threadData->config.frameStatsOverlay)
+			drawStatsOverlay();
+
+		frameStats.mark(FrameStats::Present);
+
 		swapGLBuffer();
 	}
 
@@ -660,21 +800,29 @@ Graphics::Graphics(RGSSThreadData *data)
 
 Graphics::~Graphics()
 {
+	/* No-op if it was written when the benchmark ended */
+	p->writeReport();
+
 	delete p;
 }
 
 void Graphics::update()
 {
+	TRACE_SCOPE("Graphics::update");
+
 	p->checkShutDownReset();
 	p->checkSyncLock();
 
 	if (p->frozen)
 		return;
+
+	p->frameStats.beginFrame();
     
     if (p->threadData->config.fastForwardSpeed > 0 && p->fastForward)
     {
         if(p->threadData->config.fastForwardSpeed > p->frameSkipIndex){
             p->frameSkipIndex++;
+			p->endFrame();
 			++p->frameCount;
 			p->threadData->ethread->notifyFrame();
 			return;
@@ -691,6 +839,8 @@ void Graphics::update()
 		{
 			/* Skip frame */
 			p->fpsLimiter.delay();
+			p->frameStats.mark(FrameStats::Delay);
+			p->endFrame();
 			++p->frameCount;
 			p->threadData->ethread->notifyFrame();
 
@@ -705,6 +855,8 @@ void Graphics::update()
 
 	p->checkResize();
 	p->redrawScreen();
+
+	p->screenshots.process();
 }
 
 void Graphics::toggleFastForward()
@@ -735,6 +887,10 @@ void Graphics::transition(int duration,
 	vague = clamp(vague, 1, 256);
 	Bitmap *transMap = *filename ? new Bitmap(filename) : 0;
 
+	/* The transition shader samples the map directly */
+	if (transMap)
+		transMap->ensureNonAtlas();
+
 	setBrightness(255);
 
 	/* Capture new scene */
@@ -813,9 +969,13 @@ void Graphics::transition(int duration,
 
 		/* Draw the composed frame to a buffer first
 		 * (we need this because we're skipping PingPong) */
-		FBO::bind(transBuffer.fbo);
-		FBO::clear();
-		p->screenQuad.draw();
+		{
+			GpuTimerScope gpuScope(shState->gpuTimer(), GpuTimer::Transitions);
+
+			FBO::bind(transBuffer.fbo);
+			FBO::clear();
+			p->screenQuad.draw();
+		}
 
 		p->checkResize();
 
@@ -931,7 +1091,7 @@ void Graphics::fadein(int duration)
 	}
 }
 
-Bitmap *Graphics::snapToBitmap()
+Bitmap *Graphics::snapToBitmap(bool readback)
 {
 	Bitmap *bitmap = new Bitmap(width(), height());
 
@@ -940,6 +1100,9 @@ Bitmap *Graphics::snapToBitmap()
 	/* Taint entire bitmap */
 	bitmap->taintArea(IntRect(0, 0, width(), height()));
 
+	if (readback)
+		bitmap->requestReadback(bitmap->rect());
+
 	return bitmap;
 }
 
@@ -988,43 +1151,30 @@ void Graphics::playMovie(const char *filename)
 	Debug() << "Graphics.playMovie(" << filename << ") not implemented";
 }
 
-void Graphics::screenshot(const char *filename) {
-  int w = p->scSize.x;
-  int h = p->scSize.y;
-
-  update();
-
-  SDL_Surface *tmp, *formatted, *img;
-  tmp = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32, 0, 0, 0, 0);
-  img = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32, 0, 0, 0, 0);
-  if (!tmp || !img) {
-    if (tmp)
-      SDL_FreeSurface(tmp);
-    if (img)
-      SDL_FreeSurface(img);
-    throw Exception(Exception::SDLError, "%s", SDL_GetError());
-  }
-  
-  glReadPixels(p->scOffset.x, p->scOffset.y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, tmp->pixels);
-  
-  formatted = SDL_ConvertSurfaceFormat(tmp, SDL_PIXELFORMAT_RGBA32, 0);
-  for (int i = 0; i < h; i++) {
-    memcpy((char *)img->pixels + 4 * w * i,
-           (char *)formatted->pixels + 4 * w * (h - i - 1), 4 * w);
-  }
-  if (tmp)
-    SDL_FreeSurface(tmp);
-  if (formatted)
-    SDL_FreeSurface(formatted);
-  
-  std::string fn = shState->config().gameFolder+"/"+shState->fileSystem().normalizePath(filename);
-  SDL_RWops *bmp = SDL_RWFromFile(fn.c_str(), "wb");
-  int rc = SDL_SaveBMP_RW(img, bmp, 1);
-
-  if (rc)
-    throw new Exception(Exception::SDLError, "%s", SDL_GetError());
-  if (img)
-    SDL_FreeSurface(img);
+int Graphics::screenshotAsync(const char *filename)
+{
+	update();
+
+	std::string path = shState->config().gameFolder + "/" +
+	        shState->fileSystem().normalizePath(filename);
+
+	return p->screenshots.capture(p->screen.getPP().frontBuffer(),
+	                              IntRect(0, 0, p->scRes.x, p->scRes.y), path);
+}
+
+bool Graphics::screenshotDone(int ticket)
+{
+	return p->screenshots.isDone(ticket);
+}
+
+void Graphics::screenshot(const char *filename)
+{
+	p->screenshots.wait(screenshotAsync(filename));
+}
+
+const FrameStats &Graphics::getFrameStats() const
+{
+	return p->frameStats;
 }
 
 DEF_ATTR_RD_SIMPLE(Graphics, Brightness, int, p->brightness)
@@ -27,6 +27,7 @@
 class Scene;
 class Bitmap;
 class Disposable;
+class FrameStats;
 struct RGSSThreadData;
 struct GraphicsPrivate;
 struct AtomicFlag;
@@ -50,7 +51,9 @@ public:
 	void fadeout(int duration);
 	void fadein(int duration);
 
-	Bitmap *snapToBitmap();
+	/* With 'readback', copying the snapshot to client memory
+	 * is started right away (see Bitmap::requestReadback()) */
+	Bitmap *snapToBitmap(bool readback = false);
 
 	int width() const;
 	int height() const;
@@ -58,6 +61,13 @@ public:
 	void playMovie(const char *filename);
 	void screenshot(const char *filename);
 
+	/* Like 'screenshot()', but returns right away; the
+	 * returned ticket can be polled with 'screenshotDone()' */
+	int screenshotAsync(const char *filename);
+	bool screenshotDone(int ticket);
+
+	const FrameStats &getFrameStats() const;
+
 	void reset();
 
 	/* Non-standard extension */
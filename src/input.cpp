@@ -24,6 +24,8 @@
 #include "eventthread.h"
 #include "keybindings.h"
 #include "exception.h"
+#include "inputlog.h"
+#include "debugwriter.h"
 #include "util.h"
 
 #include <SDL_scancode.h>
@@ -227,7 +229,7 @@ struct Binding
 		: target(target)
 	{}
 
-	virtual bool sourceActive() const = 0;
+	virtual bool sourceActive(const InputSnapshot &snap) const = 0;
 	virtual bool sourceRepeatable() const = 0;
 
 	Input::ButtonCode target;
@@ -243,18 +245,18 @@ struct KbBinding : public Binding
 		  source(data.source)
 	{}
 
-	bool sourceActive() const
+	bool sourceActive(const InputSnapshot &snap) const
 	{
 		/* Special case aliases */
 		if (source == SDL_SCANCODE_LSHIFT)
-			return EventThread::keyStates[source]
-			    || EventThread::keyStates[SDL_SCANCODE_RSHIFT];
+			return snap.keys[source]
+			    || snap.keys[SDL_SCANCODE_RSHIFT];
 
 		if (source == SDL_SCANCODE_RETURN)
-			return EventThread::keyStates[source]
-			    || EventThread::keyStates[SDL_SCANCODE_KP_ENTER];
+			return snap.keys[source]
+			    || snap.keys[SDL_SCANCODE_KP_ENTER];
 
-		return EventThread::keyStates[source];
+		return snap.keys[source];
 	}
 
 	bool sourceRepeatable() const
@@ -272,9 +274,9 @@ struct JsButtonBinding : public Binding
 {
 	JsButtonBinding() {}
 
-	bool sourceActive() const
+	bool sourceActive(const InputSnapshot &snap) const
 	{
-		return EventThread::joyState.buttons[source];
+		return snap.joy.buttons[source];
 	}
 
 	bool sourceRepeatable() const
@@ -298,9 +300,9 @@ struct JsAxisBinding : public Binding
 	      dir(dir)
 	{}
 
-	bool sourceActive() const
+	bool sourceActive(const InputSnapshot &snap) const
 	{
-		int val = EventThread::joyState.axes[source];
+		int val = snap.joy.axes[source];
 
 		if (dir == Negative)
 			return val < -JAXIS_THRESHOLD;
@@ -330,10 +332,10 @@ struct JsHatBinding : public Binding
 	      pos(pos)
 	{}
 
-	bool sourceActive() const
+	bool sourceActive(const InputSnapshot &snap) const
 	{
 		/* For a diagonal input accept it as an input for both the axes */
-		return (pos & EventThread::joyState.hats[source]) != 0;
+		return (pos & snap.joy.hats[source]) != 0;
 	}
 
 	bool sourceRepeatable() const
@@ -356,18 +358,18 @@ struct MsBinding : public Binding
 	      index(buttonIndex)
 	{}
 
-	bool sourceActive() const
+	bool sourceActive(const InputSnapshot &snap) const
 	{
 #ifdef __ANDROID__
-		if (index == 1 && EventThread::touchState.ignoreMouse == false)
+		if (index == 1 && snap.touch.ignoreMouse == false)
 		{
 			for (size_t i = 0; i < MAX_FINGERS; ++i)
 			{
-				if (EventThread::touchState.fingers[i].down) return true;
+				if (snap.touch.fingers[i].down) return true;
 			}
 		}
 #endif		
-		return EventThread::mouseState.buttons[index];
+		return snap.mouse.buttons[index];
 	}
 
 	bool sourceRepeatable() const
@@ -502,8 +504,19 @@ struct InputPrivate
 		int active;
 	} dir8Data;
 
+	/* What this frame's input is read from */
+	InputSnapshot snap;
+
+	InputRecorder *recorder;
+	InputReplayer *replayer;
+
+	/* Random seed of the log being recorded or replayed */
+	uint32_t logSeed;
 
 	InputPrivate(const RGSSThreadData &rtData)
+	    : recorder(0),
+	      replayer(0),
+	      logSeed(0)
 	{
 		initStaticKbBindings();
 		initMsBindings();
@@ -529,6 +542,84 @@ struct InputPrivate
 		dir4Data.previous = Input::None;
 
 		dir8Data.active = 0;
+
+		openLog(rtData.config);
+	}
+
+	~InputPrivate()
+	{
+		delete recorder;
+		delete replayer;
+	}
+
+	void openLog(const Config &conf)
+	{
+		if (!conf.inputReplay.empty())
+		{
+			if (!conf.inputRecord.empty())
+				Debug() << "Replaying input, not recording it";
+
+			replayer = new InputReplayer(conf.inputReplay.c_str());
+			logSeed = replayer->getSeed();
+		}
+		else if (!conf.inputRecord.empty())
+		{
+			logSeed = SDL_GetPerformanceCounter();
+			recorder = new InputRecorder(conf.inputRecord.c_str(), logSeed);
+		}
+	}
+
+	bool logging() const
+	{
+		return recorder || replayer;
+	}
+
+	/* Outside of 'update()', the live state is used unless a log
+	 * is active; recording and replay must see the same input */
+	const uint8_t *keyStates() const
+	{
+		return logging() ? snap.keys : EventThread::keyStates;
+	}
+
+	const EventThread::MouseState &mouseState() const
+	{
+		return logging() ? snap.mouse : EventThread::mouseState;
+	}
+
+	const EventThread::TouchState &touchState() const
+	{
+		return logging() ? snap.touch : EventThread::touchState;
+	}
+
+	bool mouseButton(int button) const
+	{
+		if (logging())
+			return snap.mouse.buttons[button];
+
+		return SDL_GetMouseState(0, 0) & SDL_BUTTON(button);
+	}
+
+	void updateSnapshot()
+	{
+		if (replayer)
+		{
+			if (replayer->read(snap))
+				return;
+
+			Debug() << "Input replay finished after" << replayer->getFrame() << "frames";
+
+			delete replayer;
+			replayer = 0;
+
+			/* Nothing else could provide input */
+			if (shState->config().headless)
+				shState->eThread().requestTerminate();
+		}
+
+		snap.capture();
+
+		if (recorder)
+			recorder->write(snap);
 	}
 
 	inline ButtonState &getStateCheck(int code)
@@ -750,7 +841,7 @@ struct InputPrivate
 	void pollBindingPriv(const Binding &b,
 	                     Input::ButtonCode &repeatCand)
 	{	
-		if (!b.sourceActive())
+		if (!b.sourceActive(snap))
 			return;
 
 		if (b.target == Input::None)
@@ -782,7 +873,7 @@ struct InputPrivate
     
     void updateRaw()
     {
-        memcpy(rawStates, shState->eThread().keyStates, SDL_NUM_SCANCODES);
+        memcpy(rawStates, snap.keys, SDL_NUM_SCANCODES);
         
         for (int i = 0; i < SDL_NUM_SCANCODES; i++)
         {
@@ -895,6 +986,7 @@ void Input::update()
 {
 	shState->checkShutdown();
 	p->checkBindingChange(shState->rtData());
+	p->updateSnapshot();
 
 	p->swapBuffers();
 	p->clearBuffer();
@@ -979,40 +1071,47 @@ int Input::dir8Value()
 int Input::mouseX()
 {
 	RGSSThreadData &rtData = shState->rtData();
-	
+	const EventThread::MouseState &mouse = p->mouseState();
+
 #ifdef __ANDROID__ 
-	if (EventThread::touchState.ignoreMouse == false)
+	const EventThread::TouchState &touch = p->touchState();
+
+	if (touch.ignoreMouse == false)
 		for (size_t i = 0; i < MAX_FINGERS; ++i)
 			{
-				EventThread::FingerState &f = EventThread::touchState.fingers[i];
+				const EventThread::FingerState &f = touch.fingers[i];
 				if (!f.down) continue;
 				return (f.x - rtData.screenOffset.x) * rtData.sizeResoRatio.x;
 			}
 #endif
 
-	return (EventThread::mouseState.x - rtData.screenOffset.x) * rtData.sizeResoRatio.x;
+	return (mouse.x - rtData.screenOffset.x) * rtData.sizeResoRatio.x;
 }
 
 int Input::mouseY()
 {
 	RGSSThreadData &rtData = shState->rtData();
+	const EventThread::MouseState &mouse = p->mouseState();
 
 #ifdef __ANDROID__ 
-	if (EventThread::touchState.ignoreMouse == false)
+	const EventThread::TouchState &touch = p->touchState();
+
+	if (touch.ignoreMouse == false)
 		for (size_t i = 0; i < MAX_FINGERS; ++i)
 			{
-				EventThread::FingerState &f = EventThread::touchState.fingers[i];
+				const EventThread::FingerState &f = touch.fingers[i];
 				if (!f.down) continue;
 				return (f.y - rtData.screenOffset.y) * rtData.sizeResoRatio.y;
 			}
 #endif
-	
-	return (EventThread::mouseState.y - rtData.screenOffset.y) * rtData.sizeResoRatio.y;
+
+	return (mouse.y - rtData.screenOffset.y) * rtData.sizeResoRatio.y;
 }
 
-#define ks(sc) shState->eThread().keyStates[SDL_SCANCODE_##sc]
+#define ks(sc) keyStates[SDL_SCANCODE_##sc]
 int Input::asyncKeyState(int key)
 {
+    const uint8_t *keyStates = p->keyStates();
     int result;
     switch(key){
         case 0x10: // Any Shift
@@ -1028,22 +1127,22 @@ int Input::asyncKeyState(int key)
             break;
 
         case 0x1: // Mouse button 1
-            result = (SDL_GetMouseState(0, 0) & SDL_BUTTON(1)) ? 0x8000 : 0;
+            result = p->mouseButton(SDL_BUTTON_LEFT) ? 0x8000 : 0;
             break;
 
         case 0x2: // Mouse button 2
-            result = (SDL_GetMouseState(0, 0) & SDL_BUTTON(3)) ? 0x8000 : 0;
+            result = p->mouseButton(SDL_BUTTON_RIGHT) ? 0x8000 : 0;
             break;
 
         case 0x4: // Middle mouse
-            result = (SDL_GetMouseState(0, 0) & SDL_BUTTON(2)) ? 0x8000 : 0;
+            result = p->mouseButton(SDL_BUTTON_MIDDLE) ? 0x8000 : 0;
             break;
 
         default:
             try {
                 // Use EventThread instead of Input because
                 // Input.update typically gets overridden
-                result = shState->eThread().keyStates[vKeyToScancode[key]] << 15;
+                result = keyStates[vKeyToScancode[key]] << 15;
             } catch (...) {
                 result = 0;
             }
@@ -1053,6 +1152,26 @@ int Input::asyncKeyState(int key)
 }
 #undef ks
 
+const uint8_t *Input::rawKeyStates()
+{
+	return p->keyStates();
+}
+
+bool Input::mouseInWindow()
+{
+	return p->mouseState().inWindow;
+}
+
+bool Input::getLogSeed(unsigned int &seed) const
+{
+	if (!p->logging())
+		return false;
+
+	seed = p->logSeed;
+
+	return true;
+}
+
 Input::~Input()
 {
 	delete p;
@@ -23,6 +23,7 @@
 #define INPUT_H
 
 #include <map>
+#include <stdint.h>
 
 extern std::map<int, int> vKeyToScancode;
 
@@ -68,6 +69,15 @@ public:
     
     int asyncKeyState(int vKey);
 
+	/* Indexed by SDL scancode, SDL_NUM_SCANCODES entries */
+	const uint8_t *rawKeyStates();
+	bool mouseInWindow();
+
+	/* While input is recorded or replayed, scripts have to
+	 * seed their RNG with this for the game to play out
+	 * the same way. Returns false otherwise */
+	bool getLogSeed(unsigned int &seed) const;
+
 private:
 	Input(const RGSSThreadData &rtData);
 	~Input();
@@ -0,0 +1,251 @@
+/*
+** inputlog.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "inputlog.h"
+
+#include "sdl-util.h"
+#include "exception.h"
+#include "debugwriter.h"
+
+#include <string.h>
+
+static const char logMagic[8] = { 'M', 'K', 'X', 'P', 'I', 'N', 'P', 'T' };
+static const uint32_t logVersion = 1;
+static const size_t headerSize = sizeof(logMagic) + 3*4;
+
+/* Unchanged gaps shorter than this are cheaper
+ * to store as part of the surrounding runs */
+static const size_t minGap = 3;
+
+InputSnapshot::InputSnapshot()
+{
+	memset(this, 0, sizeof(*this));
+}
+
+void InputSnapshot::capture()
+{
+	memcpy(keys, EventThread::keyStates, sizeof(keys));
+	memcpy(&joy, &EventThread::joyState, sizeof(joy));
+	memcpy(&mouse, &EventThread::mouseState, sizeof(mouse));
+	memcpy(&touch, &EventThread::touchState, sizeof(touch));
+}
+
+static void writeVarint(std::vector<uint8_t> &out, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	out.push_back(value);
+}
+
+static void writeLE32(uint8_t *out, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i)
+		out[i] = (value >> (i*8)) & 0xFF;
+}
+
+static uint32_t readLE32(const uint8_t *in)
+{
+	uint32_t value = 0;
+
+	for (int i = 0; i < 4; ++i)
+		value |= (uint32_t) in[i] << (i*8);
+
+	return value;
+}
+
+InputRecorder::InputRecorder(const char *filename, uint32_t seed)
+{
+	ops = RWFromFile(filename, "wb");
+
+	if (!ops)
+		throw Exception(Exception::SDLError, "Error creating input log '%s': %s",
+		                filename, SDL_GetError());
+
+	uint8_t header[headerSize];
+	memcpy(header, logMagic, sizeof(logMagic));
+	writeLE32(header + 8, logVersion);
+	writeLE32(header + 12, sizeof(InputSnapshot));
+	writeLE32(header + 16, seed);
+
+	SDL_RWwrite(ops, header, 1, sizeof(header));
+}
+
+InputRecorder::~InputRecorder()
+{
+	SDL_RWclose(ops);
+}
+
+void InputRecorder::write(const InputSnapshot &snap)
+{
+	const uint8_t *cur = reinterpret_cast<const uint8_t*>(&snap);
+	uint8_t *prev = reinterpret_cast<uint8_t*>(&last);
+	const size_t size = sizeof(InputSnapshot);
+
+	/* Collect the changed runs as (start, end) pairs */
+	std::vector<size_t> runs;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (cur[i] == prev[i])
+			continue;
+
+		if (!runs.empty() && i - runs.back() < minGap)
+			runs.back() = i + 1;
+		else
+		{
+			runs.push_back(i);
+			runs.push_back(i + 1);
+		}
+	}
+
+	buffer.clear();
+	writeVarint(buffer, runs.size() / 2);
+
+	size_t end = 0;
+
+	for (size_t i = 0; i < runs.size(); i += 2)
+	{
+		writeVarint(buffer, runs[i] - end);
+		writeVarint(buffer, runs[i+1] - runs[i]);
+		buffer.insert(buffer.end(), cur + runs[i], cur + runs[i+1]);
+
+		end = runs[i+1];
+	}
+
+	SDL_RWwrite(ops, &buffer[0], 1, buffer.size());
+
+	memcpy(prev, cur, size);
+}
+
+InputReplayer::InputReplayer(const char *filename)
+    : pos(headerSize),
+      frame(0)
+{
+	SDL_RWops *ops = RWFromFile(filename, "rb");
+
+	if (!ops)
+		throw Exception(Exception::SDLError, "Error opening input log '%s': %s",
+		                filename, SDL_GetError());
+
+	Sint64 size = SDL_RWsize(ops);
+
+	if (size > 0)
+	{
+		data.resize(size);
+		data.resize(SDL_RWread(ops, &data[0], 1, size));
+	}
+
+	SDL_RWclose(ops);
+
+	if (data.size() < headerSize || memcmp(&data[0], logMagic, sizeof(logMagic)))
+		throw Exception(Exception::MKXPError, "'%s' is not an input log", filename);
+
+	if (readLE32(&data[8]) != logVersion ||
+	    readLE32(&data[12]) != sizeof(InputSnapshot))
+		throw Exception(Exception::MKXPError,
+		                "Input log '%s' was recorded by an incompatible build", filename);
+
+	seed = readLE32(&data[16]);
+}
+
+uint32_t InputReplayer::getSeed() const
+{
+	return seed;
+}
+
+int InputReplayer::getFrame() const
+{
+	return frame;
+}
+
+bool InputReplayer::readVarint(uint32_t &value)
+{
+	value = 0;
+
+	for (int shift = 0; shift < 32; shift += 7)
+	{
+		if (pos >= data.size())
+			return false;
+
+		uint8_t byte = data[pos++];
+		value |= (uint32_t) (byte & 0x7F) << shift;
+
+		if (!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+bool InputReplayer::applyFrame(InputSnapshot &snap)
+{
+	uint8_t *out = reinterpret_cast<uint8_t*>(&snap);
+	const size_t size = sizeof(InputSnapshot);
+
+	uint32_t runCount;
+
+	if (!readVarint(runCount))
+		return false;
+
+	size_t end = 0;
+
+	for (uint32_t i = 0; i < runCount; ++i)
+	{
+		uint32_t offset, length;
+
+		if (!readVarint(offset) || !readVarint(length))
+			return false;
+
+		end += offset;
+
+		if (end + length > size || pos + length > data.size())
+			return false;
+
+		memcpy(out + end, &data[pos], length);
+
+		pos += length;
+		end += length;
+	}
+
+	return true;
+}
+
+bool InputReplayer::read(InputSnapshot &snap)
+{
+	if (pos >= data.size())
+		return false;
+
+	if (!applyFrame(snap))
+	{
+		Debug() << "Input log is corrupt after frame" << frame;
+		pos = data.size();
+
+		return false;
+	}
+
+	++frame;
+
+	return true;
+}
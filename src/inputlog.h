@@ -0,0 +1,98 @@
+/*
+** inputlog.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include "eventthread.h"
+
+#include <SDL_rwops.h>
+
+#include <vector>
+#include <stdint.h>
+
+/* Everything Input reads from the event thread, copied
+ * once per Input.update. Compared and stored bytewise,
+ * so it must stay plain data */
+struct InputSnapshot
+{
+	uint8_t keys[SDL_NUM_SCANCODES];
+	EventThread::JoyState joy;
+	EventThread::MouseState mouse;
+	EventThread::TouchState touch;
+
+	InputSnapshot();
+
+	/* Copies the current live state */
+	void capture();
+};
+
+/* A log stores each snapshot as the byte runs that changed
+ * since the previous one (which starts out zeroed):
+ *
+ *   header: "MKXPINPT", u32 version, u32 snapshot size, u32 seed
+ *   frame:  varint run count, then per run: varint offset from
+ *           the end of the previous run, varint length, data
+ *
+ * The snapshot is stored in memory layout, so logs are only
+ * valid for builds with the same snapshot size and byte order */
+class InputRecorder
+{
+public:
+	/* Throws if the file can't be created */
+	InputRecorder(const char *filename, uint32_t seed);
+	~InputRecorder();
+
+	void write(const InputSnapshot &snap);
+
+private:
+	SDL_RWops *ops;
+	InputSnapshot last;
+	std::vector<uint8_t> buffer;
+};
+
+class InputReplayer
+{
+public:
+	/* Throws if the file can't be read or wasn't
+	 * recorded by a compatible build */
+	InputReplayer(const char *filename);
+
+	uint32_t getSeed() const;
+
+	/* Number of frames replayed so far */
+	int getFrame() const;
+
+	/* Applies the next frame's changes to 'snap'.
+	 * Returns false once the log is used up */
+	bool read(InputSnapshot &snap);
+
+private:
+	std::vector<uint8_t> data;
+	size_t pos;
+	uint32_t seed;
+	int frame;
+
+	bool readVarint(uint32_t &value);
+	bool applyFrame(InputSnapshot &snap);
+};
+
+#endif // INPUTLOG_H
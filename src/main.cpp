@@ -38,6 +38,7 @@
 #include "debugwriter.h"
 #include "exception.h"
 #include "gl-fun.h"
+#include "tracer.h"
 
 #include "binding.h"
 
@@ -78,6 +79,8 @@ int rgssThreadFun(void *userdata)
 	SDL_Window *win = threadData->window;
 	SDL_GLContext glCtx;
 
+	Tracer::setThreadName("rgss");
+
 	/* Setup GL context */
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 
@@ -204,19 +207,6 @@ int main(int argc, char *argv[])
 	SDL_SetHint(SDL_HINT_VIDEO_MINIMIZE_ON_FOCUS_LOSS, "0");
 	SDL_SetHint(SDL_HINT_ACCELEROMETER_AS_JOYSTICK, "0");
 
-	/* initialize SDL first */
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER) < 0)
-	{
-		showInitError(std::string("Error initializing SDL: ") + SDL_GetError());
-		return 0;
-	}
-
-	if (!EventThread::allocUserEvents())
-	{
-		showInitError("Error allocating SDL user events");
-		return 0;
-	}
-
 #ifndef WORKDIR_CURRENT
 	/* set working directory */
 	char *dataDir = SDL_GetBasePath();
@@ -255,8 +245,34 @@ int main(int argc, char *argv[])
         }
     }
 
+	/* The config decides which video and audio
+	 * backends to use, so it's read before SDL_Init */
+	if (conf.headless)
+	{
+		/* Renders to an EGL pbuffer (SDL >= 2.0.12) */
+		SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+
+		/* Read by OpenAL Soft when the device is opened */
+		SDL_setenv("ALSOFT_DRIVERS", "null", 1);
+	}
+
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER) < 0)
+	{
+		showInitError(std::string("Error initializing SDL: ") + SDL_GetError());
+		return 0;
+	}
+
+	if (!EventThread::allocUserEvents())
+	{
+		showInitError("Error allocating SDL user events");
+		return 0;
+	}
+
 	conf.readGameINI();
 
+	Tracer::init(!conf.traceFile.empty());
+	Tracer::setThreadName("main");
+
 	if (conf.windowTitle.empty())
 		conf.windowTitle = conf.game.title;
 
@@ -320,7 +336,8 @@ int main(int argc, char *argv[])
 	/* OSX and Windows have their own native ways of
 	 * dealing with icons; don't interfere with them */
 #ifdef __LINUX__
-	setupWindowIcon(conf, win);
+	if (!conf.headless)
+		setupWindowIcon(conf, win);
 #else
 	(void) setupWindowIcon;
 #endif
@@ -412,6 +429,9 @@ int main(int argc, char *argv[])
 	/* Clean up any remainin events */
 	eventThread.cleanup();
 
+	if (!conf.traceFile.empty())
+		Tracer::dump(conf.traceFile.c_str());
+
 	Debug() << "Shutting down.";
 
 	alcCloseDevice(alcDev);
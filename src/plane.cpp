@@ -180,6 +180,9 @@ void Plane::setBitmap(Bitmap *value)
 		return;
 
 	value->ensureNonMega();
+
+	/* Repeat wrapping needs a dedicated texture */
+	value->ensureNonAtlas();
 }
 
 void Plane::setOX(int value)
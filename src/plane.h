@@ -53,6 +53,7 @@ private:
 	PlanePrivate *p;
 
 	void draw();
+	GpuTimer::Category gpuCategory() const { return GpuTimer::Planes; }
 	void onGeometryChange(const Scene::Geometry &);
 
 	void releaseResources();
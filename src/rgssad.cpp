@@ -20,10 +20,28 @@
 */
 
 #include "rgssad.h"
-#include "boost-hash.h"
+#include <SDL_platform.h>
 
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
+#include <vector>
+
+#ifdef __WINDOWS__
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static bool mmapEnabled = false;
+
+void RGSS_setMmapEnabled(bool value)
+{
+	mmapEnabled = value;
+}
 
 struct RGSS_entryData
 {
@@ -32,38 +50,482 @@ struct RGSS_entryData
 	uint32_t startMagic;
 };
 
+/* Substring of an archive's name storage */
+struct RGSS_nameRef
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct RGSS_entry
+{
+	RGSS_nameRef path;
+	RGSS_entryData data;
+};
+
+struct RGSS_dirChild
+{
+	RGSS_nameRef dir;
+	RGSS_nameRef child;
+};
+
 struct RGSS_entryHandle
 {
 	const RGSS_entryData data;
 	uint32_t currentMagic;
 	uint64_t currentOffset;
+
+	/* Exactly one of these is set. If the archive is memory
+	 * mapped, 'mapped' points to the entry's (encrypted) data
+	 * and is read from directly, otherwise 'io' is a private
+	 * handle to the archive file */
 	PHYSFS_Io *io;
+	const uint8_t *mapped;
 
-	RGSS_entryHandle(const RGSS_entryData &data, PHYSFS_Io *archIo)
+	RGSS_entryHandle(const RGSS_entryData &data, PHYSFS_Io *archIo,
+	                 const uint8_t *mapped)
 	    : data(data),
 	      currentMagic(data.startMagic),
-	      currentOffset(0)
+	      currentOffset(0),
+	      io(0),
+	      mapped(mapped)
 	{
-		io = archIo->duplicate(archIo);
+		if (!mapped)
+			io = archIo->duplicate(archIo);
+	}
+
+	RGSS_entryHandle(const RGSS_entryHandle &other)
+	    : data(other.data),
+	      currentMagic(other.currentMagic),
+	      currentOffset(other.currentOffset),
+	      io(0),
+	      mapped(other.mapped)
+	{
+		if (other.io)
+		{
+			io = other.io->duplicate(other.io);
+			io->seek(io, data.offset + currentOffset);
+		}
 	}
 
 	~RGSS_entryHandle()
 	{
-		io->destroy(io);
+		if (io)
+			io->destroy(io);
 	}
 };
 
+/* Read-only mapping of an entire archive file */
+struct RGSS_mapping
+{
+	const uint8_t *data;
+	uint64_t size;
+
+#ifdef __WINDOWS__
+	HANDLE file;
+	HANDLE fileMapping;
+#endif
+
+	RGSS_mapping()
+	    : data(0),
+	      size(0)
+	{}
+
+	bool map(const char *path);
+	void unmap();
+};
+
+#ifdef __WINDOWS__
+
+bool RGSS_mapping::map(const char *path)
+{
+	wchar_t wpath[MAX_PATH];
+
+	if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, MAX_PATH))
+		return false;
+
+	file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, 0,
+	                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	fileMapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+
+	if (!fileMapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	data = static_cast<const uint8_t*>(MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (!data)
+	{
+		CloseHandle(fileMapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	size = fileSize.QuadPart;
+
+	return true;
+}
+
+void RGSS_mapping::unmap()
+{
+	if (!data)
+		return;
+
+	UnmapViewOfFile(data);
+	CloseHandle(fileMapping);
+	CloseHandle(file);
+	data = 0;
+}
+
+#else
+
+bool RGSS_mapping::map(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void *ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	/* The mapping stays valid after closing the descriptor */
+	close(fd);
+
+	if (ptr == MAP_FAILED)
+		return false;
+
+	data = static_cast<const uint8_t*>(ptr);
+	size = st.st_size;
+
+	return true;
+}
+
+void RGSS_mapping::unmap()
+{
+	if (!data)
+		return;
+
+	munmap(const_cast<uint8_t*>(data), size);
+	data = 0;
+}
+
+#endif
+
 struct RGSS_archiveData
 {
 	PHYSFS_Io *archiveIo;
 
-	/* Maps: file path
-	 * to:   entry data */
-	BoostHash<std::string, RGSS_entryData> entryHash;
+	/* Only valid if mmap mode is enabled and
+	 * the archive could be mapped */
+	RGSS_mapping mapping;
+
+	/* All entry paths, stored back to back
+	 * (each one followed by a null terminator) */
+	std::vector<char> names;
+
+	/* Sorted by path */
+	std::vector<RGSS_entry> entries;
+
+	/* Every (directory, directly contained file or
+	 * directory) pair, sorted by directory, then child */
+	std::vector<RGSS_dirChild> dirChildren;
+
+	const char *name(const RGSS_nameRef &ref) const
+	{
+		return &names[ref.offset];
+	}
+};
+
+static int
+compareNames(const char *a, size_t aLen, const char *b, size_t bLen)
+{
+	int result = memcmp(a, b, std::min(aLen, bLen));
+
+	if (result != 0)
+		return result;
+
+	return (aLen < bLen) ? -1 : (aLen > bLen) ? 1 : 0;
+}
+
+struct RGSS_entryLess
+{
+	const RGSS_archiveData *data;
+
+	bool operator()(const RGSS_entry &a, const RGSS_entry &b) const
+	{
+		return compareNames(data->name(a.path), a.path.length,
+		                    data->name(b.path), b.path.length) < 0;
+	}
+};
+
+struct RGSS_dirChildLess
+{
+	const RGSS_archiveData *data;
+
+	int compare(const RGSS_dirChild &a, const RGSS_dirChild &b) const
+	{
+		int result = compareNames(data->name(a.dir), a.dir.length,
+		                          data->name(b.dir), b.dir.length);
+
+		if (result != 0)
+			return result;
+
+		return compareNames(data->name(a.child), a.child.length,
+		                    data->name(b.child), b.child.length);
+	}
+
+	bool operator()(const RGSS_dirChild &a, const RGSS_dirChild &b) const
+	{
+		return compare(a, b) < 0;
+	}
+};
+
+/* Appends a new entry, whose path is to be
+ * written into the returned buffer by the caller */
+static char*
+addEntry(RGSS_archiveData *data, uint32_t nameLen, const RGSS_entryData &entryData)
+{
+	RGSS_entry entry;
+	entry.path.offset = data->names.size();
+	entry.path.length = nameLen;
+	entry.data = entryData;
+
+	data->entries.push_back(entry);
+	data->names.resize(data->names.size() + nameLen + 1);
+	data->names.back() = '\0';
+
+	return &data->names[entry.path.offset];
+}
+
+/* Sorts the entries and derives the directory
+ * structure from them, once all entries were read */
+static void
+buildIndex(RGSS_archiveData *data)
+{
+	/* Keep the first of multiple equally named entries */
+	RGSS_entryLess entryLess = { data };
+	std::stable_sort(data->entries.begin(), data->entries.end(), entryLess);
+
+	for (size_t i = 0; i < data->entries.size(); ++i)
+	{
+		const RGSS_nameRef &path = data->entries[i].path;
+		const char *name = data->name(path);
+
+		/* One pair for every path component, ie.
+		 * 'a/b/c' -> ('', 'a'), ('a', 'b'), ('a/b', 'c') */
+		uint32_t compStart = 0;
+
+		for (uint32_t j = 0; j <= path.length; ++j)
+		{
+			if (j < path.length && name[j] != '/')
+				continue;
+
+			RGSS_dirChild dc;
+			dc.dir.offset = path.offset;
+			dc.dir.length = (compStart > 0) ? compStart - 1 : 0;
+			dc.child.offset = path.offset + compStart;
+			dc.child.length = j - compStart;
+
+			data->dirChildren.push_back(dc);
+			compStart = j + 1;
+		}
+	}
+
+	RGSS_dirChildLess dcLess = { data };
+	std::sort(data->dirChildren.begin(), data->dirChildren.end(), dcLess);
+
+	/* Directories appear once per contained entry */
+	size_t out = 0;
+
+	for (size_t i = 0; i < data->dirChildren.size(); ++i)
+		if (out == 0 || dcLess.compare(data->dirChildren[out-1], data->dirChildren[i]) != 0)
+			data->dirChildren[out++] = data->dirChildren[i];
+
+	data->dirChildren.resize(out);
+}
+
+static const RGSS_entryData*
+findEntry(const RGSS_archiveData *data, const char *filename)
+{
+	size_t len = strlen(filename);
+	size_t lo = 0, hi = data->entries.size();
+
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		const RGSS_nameRef &path = data->entries[mid].path;
+
+		if (compareNames(data->name(path), path.length, filename, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == data->entries.size())
+		return 0;
+
+	const RGSS_entry &entry = data->entries[lo];
+
+	if (compareNames(data->name(entry.path), entry.path.length, filename, len) != 0)
+		return 0;
+
+	return &entry.data;
+}
+
+/* Returns the index of the first child of 'dirname'
+ * and stores the number of children in 'count' */
+static size_t
+findDirChildren(const RGSS_archiveData *data, const char *dirname, size_t &count)
+{
+	size_t len = strlen(dirname);
+	size_t lo = 0, hi = data->dirChildren.size();
+
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		const RGSS_nameRef &dir = data->dirChildren[mid].dir;
+
+		if (compareNames(data->name(dir), dir.length, dirname, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	count = 0;
+
+	for (size_t i = lo; i < data->dirChildren.size(); ++i, ++count)
+	{
+		const RGSS_nameRef &dir = data->dirChildren[i].dir;
+
+		if (compareNames(data->name(dir), dir.length, dirname, len) != 0)
+			break;
+	}
+
+	return lo;
+}
+
+static bool
+hasDirectory(const RGSS_archiveData *data, const char *dirname)
+{
+	/* The root directory always exists */
+	if (!*dirname)
+		return true;
+
+	size_t count;
+	findDirChildren(data, dirname, count);
+
+	return count > 0;
+}
+
+/* Reads through a large buffer, so scanning the archive directory
+ * doesn't cost one small read (plus a seek) per header field */
+struct RGSS_reader
+{
+	PHYSFS_Io *io;
+	std::vector<uint8_t> buf;
+
+	/* Archive offset of buf[0] */
+	uint64_t bufStart;
+	size_t bufLen;
+	size_t bufPos;
+
+	RGSS_reader(PHYSFS_Io *io)
+	    : io(io),
+	      buf(64 * 1024),
+	      bufStart(io->tell(io)),
+	      bufLen(0),
+	      bufPos(0)
+	{}
+
+	uint64_t tell() const
+	{
+		return bufStart + bufPos;
+	}
+
+	bool read(void *dest, size_t size)
+	{
+		uint8_t *destP = static_cast<uint8_t*>(dest);
+
+		while (size > 0)
+		{
+			if (bufPos == bufLen && !refill())
+				return false;
+
+			size_t n = std::min(size, bufLen - bufPos);
+			memcpy(destP, &buf[bufPos], n);
 
-	/* Maps: directory path,
-	 * to:   list of contained entries */
-	BoostHash<std::string, BoostSet<std::string> > dirHash;
+			bufPos += n;
+			destP += n;
+			size -= n;
+		}
+
+		return true;
+	}
+
+	bool readUint32(uint32_t &result)
+	{
+		uint8_t buff[4];
+
+		if (!read(buff, 4))
+			return false;
+
+		result = (buff[0] << 0x00) | (buff[1] << 0x08) |
+		         (buff[2] << 0x10) | ((uint32_t) buff[3] << 0x18);
+
+		return true;
+	}
+
+	void seek(uint64_t offset)
+	{
+		/* Stay inside the buffer if possible */
+		if (offset >= bufStart && offset <= bufStart + bufLen)
+		{
+			bufPos = offset - bufStart;
+			return;
+		}
+
+		io->seek(io, offset);
+		bufStart = offset;
+		bufLen = bufPos = 0;
+	}
+
+private:
+	bool refill()
+	{
+		bufStart += bufLen;
+		bufLen = bufPos = 0;
+
+		PHYSFS_sint64 count = io->read(io, &buf[0], buf.size());
+
+		if (count <= 0)
+			return false;
+
+		bufLen = count;
+
+		return true;
+	}
 };
 
 static bool
@@ -83,6 +545,9 @@ readUint32(PHYSFS_Io *io, uint32_t &result)
 #define RGSS_HEADER "RGSSAD"
 #define RGSS_MAGIC 0xDEADCAFE
 
+/* Longest supported entry path */
+#define RGSS_MAX_NAME 511
+
 #define PHYSFS_ALLOC(type) \
 	static_cast<type*>(PHYSFS_getAllocator()->Malloc(sizeof(type)))
 
@@ -98,11 +563,120 @@ advanceMagic(uint32_t &magic)
 	return old;
 }
 
+/* The magic sequence is the affine map m -> m * 7 + 3 (mod 2^32)
+ * applied once per dword, so the magic after n dwords can be
+ * computed directly by squaring the map instead of stepping
+ * through all n dwords */
+static uint32_t
+advanceMagicBy(uint32_t magic, uint64_t n)
+{
+	/* Map to apply: m -> m * mul + add */
+	uint32_t mul = 7;
+	uint32_t add = 3;
+
+	for (; n > 0; n >>= 1)
+	{
+		if (n & 1)
+			magic = magic * mul + add;
+
+		/* Compose the map with itself */
+		add = add * mul + add;
+		mul = mul * mul;
+	}
+
+	return magic;
+}
+
+/* Xors 'count' dwords with consecutive magics starting at
+ * 'magic', and returns the magic following the last one.
+ * Runs four independent magic chains (each advanced by four
+ * steps at once) so the loop isn't serialized on the
+ * magic computation and can be vectorized */
+static uint32_t
+xorDwords(uint32_t *dwords, uint64_t count, uint32_t magic)
+{
+	/* m -> m * 7 + 3 applied four times */
+	const uint32_t mul4 = 7 * 7 * 7 * 7;
+	const uint32_t add4 = 3 * (7 * 7 * 7 + 7 * 7 + 7 + 1);
+
+	uint64_t i = 0;
+
+	if (count >= 4)
+	{
+		uint32_t lanes[4];
+
+		for (int j = 0; j < 4; ++j)
+			lanes[j] = advanceMagic(magic);
+
+		for (; i + 4 <= count; i += 4)
+			for (int j = 0; j < 4; ++j)
+			{
+				dwords[i+j] ^= lanes[j];
+				lanes[j] = lanes[j] * mul4 + add4;
+			}
+
+		magic = lanes[0];
+	}
+
+	for (; i < count; ++i)
+		dwords[i] ^= advanceMagic(magic);
+
+	return magic;
+}
+
+/* Decrypts straight from the archive mapping into
+ * the caller's buffer, without touching the file */
+static PHYSFS_sint64
+RGSS_ioReadMapped(RGSS_entryHandle *entry, void *buffer, PHYSFS_uint64 len)
+{
+	uint64_t toRead = std::min<uint64_t>(entry->data.size - entry->currentOffset, len);
+	uint64_t offs = entry->currentOffset;
+
+	const uint8_t *src = entry->mapped + offs;
+	uint8_t *dst = static_cast<uint8_t*>(buffer);
+	uint64_t remaining = toRead;
+
+	/* Bytes up to the next dword alignment */
+	while (remaining > 0 && (offs % 4) != 0)
+	{
+		*dst++ = *src++ ^ (entry->currentMagic >> 8 * (offs % 4));
+		--remaining;
+
+		if (++offs % 4 == 0)
+			advanceMagic(entry->currentMagic);
+	}
+
+	/* Aligned dwords */
+	uint64_t dwords = remaining / 4;
+
+	if (dwords > 0)
+	{
+		memcpy(dst, src, dwords * 4);
+		entry->currentMagic = xorDwords(reinterpret_cast<uint32_t*>(dst),
+		                                dwords, entry->currentMagic);
+
+		dst += dwords * 4;
+		src += dwords * 4;
+		remaining -= dwords * 4;
+	}
+
+	/* Trailing bytes, already aligned with the magic */
+	for (uint64_t i = 0; i < remaining; ++i)
+		dst[i] = src[i] ^ (entry->currentMagic >> 8 * i);
+
+	entry->currentOffset += toRead;
+
+	return toRead;
+}
+
 static PHYSFS_sint64
 RGSS_ioRead(PHYSFS_Io *self, void *buffer, PHYSFS_uint64 len)
 {
 	RGSS_entryHandle *entry = static_cast<RGSS_entryHandle*>(self->opaque);
 
+	if (entry->mapped)
+		return RGSS_ioReadMapped(entry, buffer, len);
+
 	PHYSFS_Io *io = entry->io;
 
 	uint64_t toRead = std::min<uint64_t>(entry->data.size - entry->currentOffset, len);
@@ -173,8 +747,7 @@ RGSS_ioRead(PHYSFS_Io *self, void *buffer, PHYSFS_uint64 len)
 		io->read(io, bBufferP, align);
 
 		/* Then xor them */
-		for (uint64_t i = 0; i < (align / 4); ++i)
-			dwBufferP[i] ^= advanceMagic(entry->currentMagic);
+		entry->currentMagic = xorDwords(dwBufferP, align / 4, entry->currentMagic);
 
 		bBufferP += align;
 	}
@@ -205,23 +778,14 @@ RGSS_ioSeek(PHYSFS_Io *self, PHYSFS_uint64 offset)
 	if (offset > entry->data.size-1)
 		return 0;
 
-	/* If rewinding, we need to rewind to begining */
-	if (offset < entry->currentOffset)
-	{
-		entry->currentOffset = 0;
-		entry->currentMagic = entry->data.startMagic;
-	}
-
-	/* For each overstepped alignment, advance magic */
-	uint64_t currentDword = entry->currentOffset / 4;
-	uint64_t targetDword  = offset / 4;
-	uint64_t dwordsSought = targetDword - currentDword;
-
-	for (uint64_t i = 0; i < dwordsSought; ++i)
-		advanceMagic(entry->currentMagic);
+	/* Compute the target magic directly from the start
+	 * magic, this works in both seek directions */
+	entry->currentMagic = advanceMagicBy(entry->data.startMagic, offset / 4);
 
 	entry->currentOffset = offset;
-	entry->io->seek(entry->io, entry->data.offset + entry->currentOffset);
+
+	if (entry->io)
+		entry->io->seek(entry->io, entry->data.offset + entry->currentOffset);
 
 	return 1;
 }
@@ -279,42 +843,6 @@ static const PHYSFS_Io RGSS_IoTemplate =
     RGSS_ioDestroy
 };
 
-static void
-processDirectories(RGSS_archiveData *data, BoostSet<std::string> &topLevel,
-                   char *nameBuf, uint32_t nameLen)
-{
-	/* Check for top level entries */
-	for (uint32_t i = 0; i < nameLen; ++i)
-	{
-		bool slash = nameBuf[i] == '/';
-		if (!slash && i+1 < nameLen)
-			continue;
-
-		if (slash)
-			nameBuf[i] = '\0';
-
-		topLevel.insert(nameBuf);
-
-		if (slash)
-			nameBuf[i] = '/';
-
-		break;
-	}
-
-	/* Check for more entries */
-	for (uint32_t i = nameLen; i > 0; i--)
-		if (nameBuf[i] == '/')
-		{
-			nameBuf[i] = '\0';
-
-			const char *dir = nameBuf;
-			const char *entry = &nameBuf[i+1];
-
-			BoostSet<std::string> &entryList = data->dirHash[dir];
-			entryList.insert(entry);
-		}
-}
-
 static bool
 verifyHeader(PHYSFS_Io *io, char version)
 {
@@ -332,8 +860,26 @@ verifyHeader(PHYSFS_Io *io, char version)
 	return true;
 }
 
+static void
+mapArchive(RGSS_archiveData *data, const char *name)
+{
+	if (!mmapEnabled || !name)
+		return;
+
+	/* Archives mounted through a custom PHYSFS_Io
+	 * don't necessarily have a real file behind them */
+	if (!data->mapping.map(name))
+		return;
+
+	/* Make sure we're looking at the same file */
+	PHYSFS_sint64 ioLength = data->archiveIo->length(data->archiveIo);
+
+	if (ioLength < 0 || (uint64_t) ioLength != data->mapping.size)
+		data->mapping.unmap();
+}
+
 static void*
-RGSS_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
+RGSS_openArchive(PHYSFS_Io *io, const char *name, int forWrite, int *claimed)
 {
 	if (forWrite)
 		return NULL;
@@ -347,49 +893,57 @@ RGSS_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 	RGSS_archiveData *data = new RGSS_archiveData;
 	data->archiveIo = io;
 
+	RGSS_reader reader(io);
 	uint32_t magic = RGSS_MAGIC;
 
-	/* Top level entry list */
-	BoostSet<std::string> &topLevel = data->dirHash[""];
-
 	while (true)
 	{
 		/* Read filename length,
          * if nothing was read, no files remain */
 		uint32_t nameLen;
 
-		if (!readUint32(io, nameLen))
+		if (!reader.readUint32(nameLen))
 			break;
 
 		nameLen ^= advanceMagic(magic);
 
-		static char nameBuf[512];
+		/* Sanity check against corrupted headers */
+		if (nameLen > RGSS_MAX_NAME)
+			break;
+
+		char nameBuf[RGSS_MAX_NAME];
+
+		if (!reader.read(nameBuf, nameLen))
+			break;
+
 		for (uint32_t i = 0; i < nameLen; ++i)
 		{
-			char c;
-			io->read(io, &c, 1);
-			nameBuf[i] = c ^ (advanceMagic(magic) & 0xFF);
+			nameBuf[i] ^= (advanceMagic(magic) & 0xFF);
+
 			if (nameBuf[i] == '\\')
 				nameBuf[i] = '/';
 		}
 
-		nameBuf[nameLen] = '\0';
-
 		uint32_t entrySize;
-		readUint32(io, entrySize);
+
+		if (!reader.readUint32(entrySize))
+			break;
+
 		entrySize ^= advanceMagic(magic);
 
 		RGSS_entryData entry;
-		entry.offset = io->tell(io);
+		entry.offset = reader.tell();
 		entry.size = entrySize;
 		entry.startMagic = magic;
 
-		data->entryHash.insert(nameBuf, entry);
-		processDirectories(data, topLevel, nameBuf, nameLen);
+		memcpy(addEntry(data, nameLen, entry), nameBuf, nameLen);
 
-		io->seek(io, entry.offset + entry.size);
+		reader.seek(entry.offset + entry.size);
 	}
 
+	buildIndex(data);
+	mapArchive(data, name);
+
 	return data;
 }
 
@@ -400,16 +954,23 @@ RGSS_enumerateFiles(void *opaque, const char *dirname,
 {
 	RGSS_archiveData *data = static_cast<RGSS_archiveData*>(opaque);
 
-	std::string _dirname(dirname);
-
-	if (!data->dirHash.contains(_dirname))
+	if (!hasDirectory(data, dirname))
 		return PHYSFS_ENUM_STOP;
 
-	const BoostSet<std::string> &entries = data->dirHash[_dirname];
+	size_t count;
+	size_t first = findDirChildren(data, dirname, count);
 
-	BoostSet<std::string>::const_iterator iter;
-	for (iter = entries.cbegin(); iter != entries.cend(); ++iter)
-		cb(callbackdata, origdir, iter->c_str());
+	for (size_t i = first; i < first + count; ++i)
+	{
+		/* Child names aren't null terminated in the name storage */
+		const RGSS_nameRef &child = data->dirChildren[i].child;
+		char nameBuf[RGSS_MAX_NAME+1];
+
+		memcpy(nameBuf, data->name(child), child.length);
+		nameBuf[child.length] = '\0';
+
+		cb(callbackdata, origdir, nameBuf);
+	}
 
 	return PHYSFS_ENUM_OK;
 }
@@ -419,11 +980,22 @@ RGSS_openRead(void *opaque, const char *filename)
 {
 	RGSS_archiveData *data = static_cast<RGSS_archiveData*>(opaque);
 
-	if (!data->entryHash.contains(filename))
+	const RGSS_entryData *entryDataP = findEntry(data, filename);
+
+	if (!entryDataP)
 		return 0;
 
+	const RGSS_entryData &entryData = *entryDataP;
+	const uint8_t *mapped = 0;
+
+	/* Fall back to file reads for entries not
+	 * (fully) contained in the mapping */
+	if (data->mapping.data && entryData.offset >= 0 &&
+	    entryData.offset + entryData.size <= data->mapping.size)
+		mapped = data->mapping.data + entryData.offset;
+
 	RGSS_entryHandle *entry =
-	        new RGSS_entryHandle(data->entryHash[filename], data->archiveIo);
+	        new RGSS_entryHandle(entryData, data->archiveIo, mapped);
 
 	PHYSFS_Io *io = PHYSFS_ALLOC(PHYSFS_Io);
 
@@ -438,8 +1010,10 @@ RGSS_stat(void *opaque, const char *filename, PHYSFS_Stat *stat)
 {
 	RGSS_archiveData *data = static_cast<RGSS_archiveData*>(opaque);
 
-	bool hasFile = data->entryHash.contains(filename);
-	bool hasDir  = data->dirHash.contains(filename);
+	const RGSS_entryData *entry = findEntry(data, filename);
+
+	bool hasFile = (entry != 0);
+	bool hasDir  = hasDirectory(data, filename);
 
 	if (!hasFile && !hasDir)
 	{
@@ -454,9 +1028,7 @@ RGSS_stat(void *opaque, const char *filename, PHYSFS_Stat *stat)
 
 	if (hasFile)
 	{
-		const RGSS_entryData &entry = data->entryHash[filename];
-
-		stat->filesize = entry.size;
+		stat->filesize = entry->size;
 		stat->filetype = PHYSFS_FILETYPE_REGULAR;
 	}
 	else
@@ -473,6 +1045,7 @@ RGSS_closeArchive(void *opaque)
 {
 	RGSS_archiveData *data = static_cast<RGSS_archiveData*>(opaque);
 
+	data->mapping.unmap();
 	delete data;
 }
 
@@ -531,9 +1104,9 @@ const PHYSFS_Archiver RGSS2_Archiver =
 };
 
 static bool
-readUint32AndXor(PHYSFS_Io *io, uint32_t &result, uint32_t key)
+readUint32AndXor(RGSS_reader &reader, uint32_t &result, uint32_t key)
 {
-	if (!readUint32(io, result))
+	if (!reader.readUint32(result))
 		return false;
 
 	result ^= key;
@@ -542,7 +1115,7 @@ readUint32AndXor(PHYSFS_Io *io, uint32_t &result, uint32_t key)
 }
 
 static void*
-RGSS3_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
+RGSS3_openArchive(PHYSFS_Io *io, const char *name, int forWrite, int *claimed)
 {
 	if (forWrite)
 		return NULL;
@@ -563,51 +1136,52 @@ RGSS3_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 	RGSS_archiveData *data = new RGSS_archiveData;
 	data->archiveIo = io;
 
-	/* Top level entry list */
-	BoostSet<std::string> &topLevel = data->dirHash[""];
+	/* The entry list is contiguous, so the
+	 * buffered reader never has to seek */
+	RGSS_reader reader(io);
 
 	while (true)
 	{
 		uint32_t offset, size, magic, nameLen;
 
-		if (!readUint32AndXor(io, offset, baseMagic))
+		if (!readUint32AndXor(reader, offset, baseMagic))
 			goto error;
 
 		/* Zero offset means entry list has ended */
 		if (offset == 0)
 			break;
 
-		if (!readUint32AndXor(io, size, baseMagic))
+		if (!readUint32AndXor(reader, size, baseMagic))
 			goto error;
 
-		if (!readUint32AndXor(io, magic, baseMagic))
+		if (!readUint32AndXor(reader, magic, baseMagic))
 			goto error;
 
-		if (!readUint32AndXor(io, nameLen, baseMagic))
+		if (!readUint32AndXor(reader, nameLen, baseMagic))
 			goto error;
 
-		char nameBuf[512];
-
-		if (!IO_READ(io, nameBuf, nameLen))
+		if (nameLen > RGSS_MAX_NAME)
 			goto error;
 
-		for (uint32_t i = 0; i < nameLen; ++i)
 		{
-			nameBuf[i] ^= ((baseMagic >> 8*(i%4)) & 0xFF);
+			RGSS_entryData entry;
+			entry.offset = offset;
+			entry.size = size;
+			entry.startMagic = magic;
 
-			if (nameBuf[i] == '\\')
-				nameBuf[i] = '/';
-		}
+			char *path = addEntry(data, nameLen, entry);
 
-		nameBuf[nameLen] = '\0';
+			if (!reader.read(path, nameLen))
+				goto error;
 
-		RGSS_entryData entry;
-		entry.offset = offset;
-		entry.size = size;
-		entry.startMagic = magic;
+			for (uint32_t i = 0; i < nameLen; ++i)
+			{
+				path[i] ^= ((baseMagic >> 8*(i%4)) & 0xFF);
 
-		data->entryHash.insert(nameBuf, entry);
-		processDirectories(data, topLevel, nameBuf, nameLen);
+				if (path[i] == '\\')
+					path[i] = '/';
+			}
+		}
 
 		continue;
 
@@ -616,6 +1190,9 @@ RGSS3_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 		return NULL;
 	}
 
+	buildIndex(data);
+	mapArchive(data, name);
+
 	return data;
 }
 
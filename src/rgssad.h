@@ -28,4 +28,8 @@ extern const PHYSFS_Archiver RGSS1_Archiver;
 extern const PHYSFS_Archiver RGSS2_Archiver;
 extern const PHYSFS_Archiver RGSS3_Archiver;
 
+/* If enabled, archives opened afterwards are memory mapped
+ * and entries are decrypted directly from the mapping */
+void RGSS_setMmapEnabled(bool value);
+
 #endif // RGSSAD_H
@@ -21,6 +21,8 @@
 
 #include "scene.h"
 #include "sharedstate.h"
+#include "spritebatch.h"
+#include "tracer.h"
 
 Scene::Scene()
 {}
@@ -90,15 +92,28 @@ void Scene::notifyGeometryChange()
 
 void Scene::composite()
 {
+	TRACE_SCOPE("Scene::composite");
+
 	IntruListLink<SceneElement> *iter;
+	SpriteBatch &batch = shState->spriteBatch();
 
 	for (iter = elements.begin(); iter != elements.end(); iter = iter->next)
 	{
 		SceneElement *e = iter->data;
 
-		if (e->visible)
-			e->draw();
+		if (!e->visible)
+			continue;
+
+		if (e->drawBatched(batch))
+			continue;
+
+		batch.flush();
+
+		GpuTimerScope gpuScope(shState->gpuTimer(), e->gpuCategory());
+		e->draw();
 	}
+
+	batch.flush();
 }
 
 
@@ -26,8 +26,10 @@
 #include "intrulist.h"
 #include "etc.h"
 #include "etc-internal.h"
+#include "gputimer.h"
 
 class SceneElement;
+class SpriteBatch;
 class Viewport;
 class WindowVX;
 class Window;
@@ -112,6 +114,15 @@ protected:
 	 */
 	virtual void draw() = 0;
 
+	/* Offers the element to the sprite batch instead of drawing
+	 * it immediately. Returns false if the element has to go
+	 * through 'draw()'; any pending batch is flushed before that.
+	 * Elements queuing themselves must not touch GL state here */
+	virtual bool drawBatched(SpriteBatch &) { return false; }
+
+	/* Which GpuTimer category 'draw()' is accounted to */
+	virtual GpuTimer::Category gpuCategory() const { return GpuTimer::Other; }
+
 	// FIXME: This should be a signal
 	virtual void onGeometryChange(const Scene::Geometry &) {}
 
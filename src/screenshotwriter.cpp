@@ -0,0 +1,398 @@
+/*
+** screenshotwriter.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "screenshotwriter.h"
+
+#include "gl-util.h"
+#include "exception.h"
+#include "boost-hash.h"
+#include "sdl-util.h"
+#include "debugwriter.h"
+#include "util.h"
+
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+#include <SDL_surface.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+/* Failures not yet reported through 'isDone()'.
+ * Older ones are only logged past this */
+#define MAX_ERRORS 16
+
+struct ShotJob
+{
+	int ticket;
+	std::string path;
+	int width, height;
+
+	/* Pending readback, RGSS thread only */
+	GLuint pbo;
+	_GLsync fence;
+
+	/* Tightly packed RGBA, top row first */
+	std::vector<uint8_t> pixels;
+
+	/* Set by the worker */
+	std::string error;
+
+	ShotJob(int ticket, const std::string &path, int width, int height)
+	    : ticket(ticket),
+	      path(path),
+	      width(width),
+	      height(height),
+	      pbo(0),
+	      fence(0)
+	{}
+};
+
+struct ScreenshotWriterPrivate
+{
+	/* Jobs whose readback is still in flight,
+	 * oldest first. Only touched by the RGSS thread */
+	std::vector<ShotJob*> reading;
+
+	/* Started on first use */
+	SDL_Thread *worker;
+	bool workerFailed;
+
+	/* Guards everything in this block */
+	SDL_mutex *mutex;
+	SDL_cond *workCond;
+	SDL_cond *doneCond;
+	std::deque<ShotJob*> queue;
+	/* Queued or being written; the worker frees
+	 * jobs as soon as they're written */
+	BoostHash<int, ShotJob*> jobs;
+	std::map<int, std::string> errors;
+	bool quit;
+
+	int nextTicket;
+
+	ScreenshotWriterPrivate()
+	    : worker(0),
+	      workerFailed(false),
+	      quit(false),
+	      nextTicket(0)
+	{
+		mutex = SDL_CreateMutex();
+		workCond = SDL_CreateCond();
+		doneCond = SDL_CreateCond();
+	}
+
+	~ScreenshotWriterPrivate()
+	{
+		SDL_DestroyCond(doneCond);
+		SDL_DestroyCond(workCond);
+		SDL_DestroyMutex(mutex);
+	}
+
+	static void writeJob(ShotJob *job)
+	{
+		SDL_Surface *surf =
+			SDL_CreateRGBSurfaceWithFormatFrom(dataPtr(job->pixels),
+			                                   job->width, job->height, 32,
+			                                   job->width * 4, SDL_PIXELFORMAT_RGBA32);
+
+		/* Alpha is meaningless for the screen */
+		SDL_Surface *conv = surf ? SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_RGB888, 0) : 0;
+		SDL_RWops *ops = conv ? RWFromFile(job->path.c_str(), "wb") : 0;
+
+		if (!ops || SDL_SaveBMP_RW(conv, ops, 1) != 0)
+			job->error = SDL_GetError();
+
+		if (conv)
+			SDL_FreeSurface(conv);
+
+		if (surf)
+			SDL_FreeSurface(surf);
+
+		std::vector<uint8_t>().swap(job->pixels);
+	}
+
+	/* Drops a written job, keeping only its error
+	 * around. Called with the mutex held */
+	void finish(ShotJob *job)
+	{
+		jobs.remove(job->ticket);
+
+		if (!job->error.empty())
+		{
+			if (errors.size() >= MAX_ERRORS)
+			{
+				std::map<int, std::string>::iterator oldest = errors.begin();
+				Debug() << "Failed to write screenshot" << oldest->second;
+				errors.erase(oldest);
+			}
+
+			errors[job->ticket] = "'" + job->path + "': " + job->error;
+		}
+
+		delete job;
+	}
+
+	void workerFun()
+	{
+		SDL_LockMutex(mutex);
+
+		while (true)
+		{
+			while (queue.empty() && !quit)
+				SDL_CondWait(workCond, mutex);
+
+			/* Drain the queue before quitting */
+			if (queue.empty())
+				break;
+
+			ShotJob *job = queue.front();
+			queue.pop_front();
+
+			SDL_UnlockMutex(mutex);
+
+			writeJob(job);
+
+			SDL_LockMutex(mutex);
+
+			finish(job);
+
+			SDL_CondBroadcast(doneCond);
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+	void submit(ShotJob *job)
+	{
+		if (!worker && !workerFailed)
+		{
+			worker = createSDLThread
+				<ScreenshotWriterPrivate, &ScreenshotWriterPrivate::workerFun>(this, "screenshot");
+
+			if (!worker)
+			{
+				Debug() << "Failed to create screenshot thread:" << SDL_GetError();
+				workerFailed = true;
+			}
+		}
+
+		/* No worker, write it right here */
+		if (!worker)
+		{
+			writeJob(job);
+
+			SDL_LockMutex(mutex);
+			finish(job);
+			SDL_UnlockMutex(mutex);
+
+			return;
+		}
+
+		SDL_LockMutex(mutex);
+
+		jobs.insert(job->ticket, job);
+		queue.push_back(job);
+		SDL_CondSignal(workCond);
+
+		SDL_UnlockMutex(mutex);
+	}
+
+	/* Copies the finished readback out of the pack buffer.
+	 * Returns false if the GPU isn't done yet and 'block'
+	 * isn't set */
+	bool collect(ShotJob *job, bool block)
+	{
+		if (block)
+		{
+			gl.ClientWaitSync(job->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+		else
+		{
+			GLenum status = gl.ClientWaitSync(job->fence, 0, 0);
+
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				return false;
+		}
+
+		gl.DeleteSync(job->fence);
+		job->fence = 0;
+
+		const size_t size = job->width * job->height * 4;
+		job->pixels.resize(size);
+
+		gl.BindBuffer(GL_PIXEL_PACK_BUFFER, job->pbo);
+
+		void *data = gl.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+
+		if (data)
+		{
+			memcpy(dataPtr(job->pixels), data, size);
+			gl.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+
+		gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		gl.DeleteBuffers(1, &job->pbo);
+		job->pbo = 0;
+
+		return true;
+	}
+
+	/* Forces the readback of 'ticket', if it's still in flight */
+	void collectTicket(int ticket)
+	{
+		for (size_t i = 0; i < reading.size(); ++i)
+		{
+			if (reading[i]->ticket != ticket)
+				continue;
+
+			ShotJob *job = reading[i];
+			reading.erase(reading.begin() + i);
+
+			collect(job, true);
+			submit(job);
+
+			return;
+		}
+	}
+};
+
+ScreenshotWriter::ScreenshotWriter()
+{
+	p = new ScreenshotWriterPrivate;
+}
+
+ScreenshotWriter::~ScreenshotWriter()
+{
+	for (size_t i = 0; i < p->reading.size(); ++i)
+	{
+		p->collect(p->reading[i], true);
+		p->submit(p->reading[i]);
+	}
+
+	if (p->worker)
+	{
+		SDL_LockMutex(p->mutex);
+		p->quit = true;
+		SDL_CondBroadcast(p->workCond);
+		SDL_UnlockMutex(p->mutex);
+
+		SDL_WaitThread(p->worker, 0);
+	}
+
+	std::map<int, std::string>::const_iterator iter;
+	for (iter = p->errors.begin(); iter != p->errors.end(); ++iter)
+		Debug() << "Failed to write screenshot" << iter->second;
+
+	delete p;
+}
+
+int ScreenshotWriter::capture(TEXFBO &source, const IntRect &rect, const std::string &path)
+{
+	ShotJob *job = new ShotJob(p->nextTicket++, path, rect.w, rect.h);
+
+	FBO::bind(source.fbo);
+
+	if (!gl.async_readback)
+	{
+		job->pixels.resize(rect.w * rect.h * 4);
+		gl.ReadPixels(rect.x, rect.y, rect.w, rect.h,
+		              GL_RGBA, GL_UNSIGNED_BYTE, dataPtr(job->pixels));
+
+		p->submit(job);
+
+		return job->ticket;
+	}
+
+	gl.GenBuffers(1, &job->pbo);
+	gl.BindBuffer(GL_PIXEL_PACK_BUFFER, job->pbo);
+	gl.BufferData(GL_PIXEL_PACK_BUFFER, rect.w * rect.h * 4, 0, GL_STREAM_READ);
+	gl.ReadPixels(rect.x, rect.y, rect.w, rect.h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	job->fence = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	p->reading.push_back(job);
+
+	return job->ticket;
+}
+
+void ScreenshotWriter::process()
+{
+	size_t i = 0;
+
+	/* Fences pass in order, stop at the first pending one */
+	for (; i < p->reading.size(); ++i)
+	{
+		if (!p->collect(p->reading[i], false))
+			break;
+
+		p->submit(p->reading[i]);
+	}
+
+	p->reading.erase(p->reading.begin(), p->reading.begin() + i);
+}
+
+bool ScreenshotWriter::isDone(int ticket)
+{
+	process();
+
+	for (size_t i = 0; i < p->reading.size(); ++i)
+		if (p->reading[i]->ticket == ticket)
+			return false;
+
+	SDL_LockMutex(p->mutex);
+
+	if (p->jobs.contains(ticket))
+	{
+		SDL_UnlockMutex(p->mutex);
+		return false;
+	}
+
+	std::map<int, std::string>::iterator iter = p->errors.find(ticket);
+	std::string error;
+
+	if (iter != p->errors.end())
+	{
+		error = iter->second;
+		p->errors.erase(iter);
+	}
+
+	SDL_UnlockMutex(p->mutex);
+
+	if (!error.empty())
+		throw Exception(Exception::SDLError, "Error writing screenshot %s", error.c_str());
+
+	return true;
+}
+
+void ScreenshotWriter::wait(int ticket)
+{
+	p->collectTicket(ticket);
+
+	SDL_LockMutex(p->mutex);
+
+	while (p->jobs.contains(ticket))
+		SDL_CondWait(p->doneCond, p->mutex);
+
+	SDL_UnlockMutex(p->mutex);
+
+	isDone(ticket);
+}
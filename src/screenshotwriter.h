@@ -0,0 +1,63 @@
+/*
+** screenshotwriter.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCREENSHOTWRITER_H
+#define SCREENSHOTWRITER_H
+
+#include "etc-internal.h"
+
+#include <string>
+
+struct TEXFBO;
+struct ScreenshotWriterPrivate;
+
+/* Saves screenshots without stalling the RGSS thread.
+ * The pixels are read into a pack buffer and picked up
+ * once the GPU is done with them (a frame later), then
+ * converted and written to disk on a worker thread */
+class ScreenshotWriter
+{
+public:
+	ScreenshotWriter();
+
+	/* Finishes all queued screenshots */
+	~ScreenshotWriter();
+
+	/* Queues 'rect' of 'source' to be written to 'path'.
+	 * Returns a ticket to query the screenshot's state with */
+	int capture(TEXFBO &source, const IntRect &rect, const std::string &path);
+
+	/* Hands readbacks the GPU has finished to the worker.
+	 * Called once per frame */
+	void process();
+
+	/* Whether the screenshot has been written. Throws
+	 * if writing it failed. Unknown tickets count as done */
+	bool isDone(int ticket);
+
+	/* Blocks until the screenshot has been written */
+	void wait(int ticket);
+
+private:
+	ScreenshotWriterPrivate *p;
+};
+
+#endif // SCREENSHOTWRITER_H
@@ -23,6 +23,7 @@
 #include "sharedstate.h"
 #include "glstate.h"
 #include "exception.h"
+#include "shadercache.h"
 
 #include <assert.h>
 #include <string.h>
@@ -46,6 +47,8 @@
 #include "simple.vert.xxd"
 #include "simpleColor.vert.xxd"
 #include "sprite.vert.xxd"
+#include "spriteBatch.vert.xxd"
+#include "spriteBatch.frag.xxd"
 #include "tilemap.vert.xxd"
 #include "blur.frag.xxd"
 #include "simpleMatrix.vert.xxd"
@@ -153,6 +156,19 @@ void Shader::init(const unsigned char *vert, int vertSize,
 {
 	GLint success;
 
+	/* Key the program by everything that goes into it */
+	uint64_t key = ShaderCache::hash(&gl.glsles, sizeof(gl.glsles));
+	key = ShaderCache::hash(mkxp_shader_common_h, mkxp_shader_common_h_len, key);
+	key = ShaderCache::hash(&vertSize, sizeof(vertSize), key);
+	key = ShaderCache::hash(vert, vertSize, key);
+	key = ShaderCache::hash(&fragSize, sizeof(fragSize), key);
+	key = ShaderCache::hash(frag, fragSize, key);
+
+	ShaderCache *cache = ShaderCache::getActive();
+
+	if (cache && cache->load(program, key))
+		return;
+
 	/* Compile vertex shader */
 	setupShaderSource(vertShader, GL_VERTEX_SHADER, vert, vertSize);
 	gl.CompileShader(vertShader);
@@ -188,6 +204,11 @@ void Shader::init(const unsigned char *vert, int vertSize,
 	gl.BindAttribLocation(program, Position, "position");
 	gl.BindAttribLocation(program, TexCoord, "texCoord");
 	gl.BindAttribLocation(program, Color, "color");
+	gl.BindAttribLocation(program, Tone, "tone");
+	gl.BindAttribLocation(program, Opacity, "opacity");
+
+	if (cache)
+		cache->prepare(program);
 
 	gl.LinkProgram(program);
 
@@ -200,6 +221,9 @@ void Shader::init(const unsigned char *vert, int vertSize,
 	                    "GLSL: An error occured while linking program '%s' (vertex '%s', fragment '%s')",
 	                    programName, vertName, fragName);
 	}
+
+	if (cache)
+		cache->store(program, key);
 }
 
 void Shader::initFromFile(const char *_vertFile, const char *_fragFile,
@@ -250,6 +274,7 @@ void ShaderBase::GLProjMat::apply(const Vec2i &value)
 void ShaderBase::init()
 {
 	GET_U(texSizeInv);
+	GET_U(texOffset);
 	GET_U(translation);
 
 	projMat.u_mat = gl.GetUniformLocation(program, "projMat");
@@ -261,9 +286,16 @@ void ShaderBase::applyViewportProj()
 	projMat.set(Vec2i(vp.w, vp.h));
 }
 
-void ShaderBase::setTexSize(const Vec2i &value)
+void ShaderBase::setTexSize(const Vec2i &value, const Vec2i &offset)
 {
 	gl.Uniform2f(u_texSizeInv, 1.f / value.x, 1.f / value.y);
+
+	/* Almost always zero, skip redundant uploads */
+	if (offset == texOffset)
+		return;
+
+	gl.Uniform2f(u_texOffset, offset.x, offset.y);
+	texOffset = offset;
 }
 
 void ShaderBase::setTranslation(const Vec2i &value)
@@ -354,6 +386,14 @@ void AlphaSpriteShader::setAlpha(float value)
 }
 
 
+SpriteBatchShader::SpriteBatchShader()
+{
+	INIT_SHADER(spriteBatch, spriteBatch, SpriteBatchShader);
+
+	ShaderBase::init();
+}
+
+
 TransShader::TransShader()
 {
 	INIT_SHADER(simple, trans, TransShader);
@@ -652,3 +692,10 @@ void BltShader::setOpacity(float value)
 {
 	gl.Uniform1f(u_opacity, value);
 }
+
+ShaderSet::ShaderSet(const Config &conf)
+    : cache(conf)
+{
+	/* All members are set up at this point */
+	cache.finish();
+}
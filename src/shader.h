@@ -25,6 +25,9 @@
 #include "etc-internal.h"
 #include "gl-util.h"
 #include "glstate.h"
+#include "shadercache.h"
+
+struct Config;
 
 class Shader
 {
@@ -36,7 +39,9 @@ public:
 	{
 		Position = 0,
 		TexCoord = 1,
-		Color = 2
+		Color = 2,
+		Tone = 3,
+		Opacity = 4
 	};
 
 protected:
@@ -78,13 +83,18 @@ public:
 	 * and loads it into the shaders uniform */
 	void applyViewportProj();
 
-	void setTexSize(const Vec2i &value);
+	/* 'offset' is added to the texture coordinates before
+	 * normalization (used for bitmaps living in an atlas) */
+	void setTexSize(const Vec2i &value, const Vec2i &offset = Vec2i());
 	void setTranslation(const Vec2i &value);
 
 protected:
 	void init();
 
-	GLint u_texSizeInv, u_translation;
+	GLint u_texSizeInv, u_texOffset, u_translation;
+
+	/* Last uploaded 'u_texOffset' value */
+	Vec2i texOffset;
 };
 
 class FlatColorShader : public ShaderBase
@@ -144,6 +154,14 @@ private:
 	GLint u_spriteMat, u_alpha;
 };
 
+/* Batched sprites; all effect parameters are
+ * passed in as vertex attributes */
+class SpriteBatchShader : public ShaderBase
+{
+public:
+	SpriteBatchShader();
+};
+
 class TransShader : public ShaderBase
 {
 public:
@@ -314,6 +332,11 @@ private:
 /* Global object containing all available shaders */
 struct ShaderSet
 {
+	ShaderSet(const Config &conf);
+
+	/* Must be constructed before any of the shaders */
+	ShaderCache cache;
+
 	FlatColorShader flatColor;
 	SimpleShader simple;
 	SimpleColorShader simpleColor;
@@ -321,6 +344,7 @@ struct ShaderSet
 	SimpleSpriteShader simpleSprite;
 	AlphaSpriteShader alphaSprite;
 	SpriteShader sprite;
+	SpriteBatchShader spriteBatch;
 	PlaneShader plane;
 	GrayShader gray;
 	TilemapShader tilemap;
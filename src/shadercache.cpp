@@ -0,0 +1,358 @@
+/*
+** shadercache.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "shadercache.h"
+
+#include "config.h"
+#include "debugwriter.h"
+
+#include <SDL_timer.h>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdio.h>
+
+#define CACHE_FILE "shadercache.bin"
+
+/* Bump when the way programs are set up changes
+ * (eg. attribute bindings) without their sources */
+#define FORMAT_VER 1
+
+/* Arbitrary sanity limit for a single program */
+#define MAX_BINARY_SIZE (16 * 1024 * 1024)
+
+struct CacheHeader
+{
+	char magic[8];
+	uint32_t formVer;
+	uint32_t count;
+	uint64_t driverHash;
+};
+
+struct EntryHeader
+{
+	uint64_t key;
+	uint32_t format;
+	uint32_t size;
+};
+
+static const char cacheMagic[8] = { 'M', 'K', 'X', 'P', 'S', 'H', 'D', 'R' };
+
+struct CacheEntry
+{
+	GLenum format;
+	std::vector<uint8_t> data;
+
+	/* Entries not used by this build are dropped on write */
+	bool used;
+};
+
+struct ShaderCachePrivate
+{
+	bool enabled;
+	std::string path;
+	uint64_t driverHash;
+
+	std::map<uint64_t, CacheEntry> entries;
+	std::set<GLenum> formats;
+	bool dirty;
+
+	int loaded;
+	int compiled;
+	uint64_t startTicks;
+
+	ShaderCachePrivate()
+	    : enabled(false),
+	      driverHash(0),
+	      dirty(false),
+	      loaded(0),
+	      compiled(0),
+	      startTicks(SDL_GetPerformanceCounter())
+	{}
+
+	void read()
+	{
+		FILE *f = fopen(path.c_str(), "rb");
+
+		if (!f)
+			return;
+
+		CacheHeader hd;
+
+		if (fread(&hd, sizeof(hd), 1, f) < 1 ||
+		    memcmp(hd.magic, cacheMagic, sizeof(cacheMagic)) ||
+		    hd.formVer != FORMAT_VER || hd.driverHash != driverHash)
+		{
+			Debug() << "Shader cache is outdated, rebuilding it";
+			fclose(f);
+
+			return;
+		}
+
+		for (uint32_t i = 0; i < hd.count; ++i)
+		{
+			EntryHeader eh;
+
+			if (fread(&eh, sizeof(eh), 1, f) < 1 || eh.size > MAX_BINARY_SIZE)
+				break;
+
+			CacheEntry &entry = entries[eh.key];
+			entry.format = eh.format;
+			entry.used = false;
+			entry.data.resize(eh.size);
+
+			if (eh.size > 0 && fread(&entry.data[0], eh.size, 1, f) < 1)
+			{
+				entries.erase(eh.key);
+				break;
+			}
+		}
+
+		fclose(f);
+	}
+
+	bool hasUnused() const
+	{
+		std::map<uint64_t, CacheEntry>::const_iterator iter;
+
+		for (iter = entries.begin(); iter != entries.end(); ++iter)
+			if (!iter->second.used)
+				return true;
+
+		return false;
+	}
+
+	void write()
+	{
+		FILE *f = fopen(path.c_str(), "wb");
+
+		if (!f)
+		{
+			Debug() << "Failed to write shader cache to" << path;
+			return;
+		}
+
+		std::map<uint64_t, CacheEntry>::const_iterator iter;
+
+		CacheHeader hd;
+		memcpy(hd.magic, cacheMagic, sizeof(cacheMagic));
+		hd.formVer = FORMAT_VER;
+		hd.count = 0;
+		hd.driverHash = driverHash;
+
+		for (iter = entries.begin(); iter != entries.end(); ++iter)
+			if (iter->second.used)
+				++hd.count;
+
+		bool ok = fwrite(&hd, sizeof(hd), 1, f) == 1;
+
+		for (iter = entries.begin(); ok && iter != entries.end(); ++iter)
+		{
+			const CacheEntry &entry = iter->second;
+
+			if (!entry.used)
+				continue;
+
+			EntryHeader eh;
+			eh.key = iter->first;
+			eh.format = entry.format;
+			eh.size = entry.data.size();
+
+			ok = fwrite(&eh, sizeof(eh), 1, f) == 1 &&
+			     fwrite(&entry.data[0], eh.size, 1, f) == 1;
+		}
+
+		fclose(f);
+
+		/* A truncated cache is harmless, but pointless to keep */
+		if (!ok)
+			remove(path.c_str());
+	}
+};
+
+static ShaderCache *activeCache = 0;
+
+static void appendGLString(std::string &out, GLenum name)
+{
+	const GLubyte *str = gl.GetString(name);
+
+	if (str)
+		out += (const char*) str;
+
+	out += '\n';
+}
+
+ShaderCache::ShaderCache(const Config &conf)
+{
+	p = new ShaderCachePrivate;
+
+	activeCache = this;
+
+	const std::string &dir = conf.customDataPath.empty() ?
+		conf.commonDataPath : conf.customDataPath;
+
+	if (!conf.shaderCache || dir.empty() || !gl.program_binary)
+		return;
+
+	GLint formatCount = 0;
+	gl.GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	if (formatCount <= 0)
+		return;
+
+	std::vector<GLint> formats(formatCount);
+	gl.GetIntegerv(GL_PROGRAM_BINARY_FORMATS, &formats[0]);
+	p->formats.insert(formats.begin(), formats.end());
+
+	/* The binaries are only valid for the exact driver they came from */
+	std::string driver;
+	appendGLString(driver, GL_VENDOR);
+	appendGLString(driver, GL_RENDERER);
+	appendGLString(driver, GL_VERSION);
+
+	p->enabled = true;
+	p->path = dir + CACHE_FILE;
+	p->driverHash = hash(driver.c_str(), driver.size());
+
+	p->read();
+}
+
+ShaderCache::~ShaderCache()
+{
+	if (activeCache == this)
+		activeCache = 0;
+
+	delete p;
+}
+
+ShaderCache *ShaderCache::getActive()
+{
+	return activeCache;
+}
+
+bool ShaderCache::load(GLuint program, uint64_t key)
+{
+	if (!p->enabled)
+		return false;
+
+	std::map<uint64_t, CacheEntry>::iterator iter = p->entries.find(key);
+
+	if (iter == p->entries.end())
+		return false;
+
+	CacheEntry &entry = iter->second;
+
+	if (entry.data.empty() || !p->formats.count(entry.format))
+		return false;
+
+	gl.ProgramBinary(program, entry.format, &entry.data[0], entry.data.size());
+
+	GLint success;
+	gl.GetProgramiv(program, GL_LINK_STATUS, &success);
+
+	/* Rejected binaries are replaced on 'store()' */
+	if (!success)
+		return false;
+
+	entry.used = true;
+	++p->loaded;
+
+	return true;
+}
+
+void ShaderCache::prepare(GLuint program)
+{
+	/* Without the hint, drivers may not keep a binary
+	 * around, or return one they reject later */
+	if (p->enabled && gl.ProgramParameteri)
+		gl.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ShaderCache::store(GLuint program, uint64_t key)
+{
+	++p->compiled;
+
+	if (!p->enabled)
+		return;
+
+	GLint size = 0;
+	gl.GetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+
+	if (size <= 0 || size > MAX_BINARY_SIZE)
+		return;
+
+	CacheEntry &entry = p->entries[key];
+	entry.data.resize(size);
+
+	GLsizei written = 0;
+	gl.GetProgramBinary(program, size, &written, &entry.format, &entry.data[0]);
+
+	if (written <= 0)
+	{
+		p->entries.erase(key);
+		return;
+	}
+
+	entry.data.resize(written);
+	entry.used = true;
+
+	p->dirty = true;
+}
+
+void ShaderCache::finish()
+{
+	if (activeCache == this)
+		activeCache = 0;
+
+	/* Also prunes entries of older builds' shaders */
+	if (p->enabled && (p->dirty || p->hasUnused()))
+		p->write();
+
+	double ms = (SDL_GetPerformanceCounter() - p->startTicks) * 1000.0
+	          / SDL_GetPerformanceFrequency();
+
+	char buf[128];
+	snprintf(buf, sizeof(buf), "Shaders set up in %.1f ms (%d cached, %d compiled)",
+	         ms, p->loaded, p->compiled);
+
+	Debug() << buf;
+
+	/* The binaries aren't needed anymore */
+	p->entries.clear();
+}
+
+uint64_t ShaderCache::hash(const void *data, size_t size, uint64_t seed)
+{
+	/* FNV-1a */
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+	uint64_t h = seed;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ULL;
+	}
+
+	return h;
+}
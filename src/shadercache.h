@@ -0,0 +1,69 @@
+/*
+** shadercache.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include "gl-fun.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Config;
+struct ShaderCachePrivate;
+
+/* Keeps linked program binaries in the user data directory,
+ * so later launches can skip compiling the shaders. Programs
+ * are keyed by a hash of their sources; all of them are
+ * dropped when the GL vendor, renderer or version changes.
+ *
+ * A cache is active from its construction until 'finish()',
+ * which is the time the ShaderSet takes to set up */
+class ShaderCache
+{
+public:
+	ShaderCache(const Config &conf);
+	~ShaderCache();
+
+	/* Null if no cache is active or it is disabled */
+	static ShaderCache *getActive();
+
+	/* Returns false if 'program' has to be compiled */
+	bool load(GLuint program, uint64_t key);
+
+	/* Call before linking a program that will be stored */
+	void prepare(GLuint program);
+
+	/* Saves a freshly linked program */
+	void store(GLuint program, uint64_t key);
+
+	/* Writes back the cache if it changed, and
+	 * logs how long setting up the shaders took */
+	void finish();
+
+	static uint64_t hash(const void *data, size_t size,
+	                     uint64_t seed = 14695981039346656037ULL);
+
+private:
+	ShaderCachePrivate *p;
+};
+
+#endif // SHADERCACHE_H
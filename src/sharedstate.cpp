@@ -29,11 +29,17 @@
 #include "glstate.h"
 #include "shader.h"
 #include "texpool.h"
+#include "bitmapcache.h"
+#include "bitmapatlas.h"
+#include "textcache.h"
+#include "bitmaploader.h"
 #include "font.h"
 #include "eventthread.h"
 #include "gl-util.h"
 #include "global-ibo.h"
 #include "quad.h"
+#include "spritebatch.h"
+#include "gputimer.h"
 #include "binding.h"
 #include "exception.h"
 #include "sharedmidistate.h"
@@ -41,6 +47,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <string>
+#include <algorithm>
 
 SharedState *SharedState::instance = 0;
 int SharedState::rgssVersion = 0;
@@ -59,6 +66,15 @@ static const char *gameArchExt()
 	return 0;
 }
 
+/* Converts a cache size option (in MiB) to bytes. The caches
+ * account in uint32_t, and add an object's size to their
+ * current usage before checking it against the limit, so
+ * the limit stays below 2 GiB */
+static uint32_t cacheSizeBytes(int mib)
+{
+	return (uint32_t) clamp(mib, 0, 2047) * 1024 * 1024;
+}
+
 struct SharedStatePrivate
 {
 	void *bindingData;
@@ -82,6 +98,10 @@ struct SharedStatePrivate
 	ShaderSet shaders;
 
 	TexPool texPool;
+	BitmapCache bitmapCache;
+	BitmapLoader bitmapLoader;
+	BitmapAtlas bitmapAtlas;
+	TextCache textCache;
 
 	SharedFontState fontState;
 	Font *defaultFont;
@@ -96,12 +116,17 @@ struct SharedStatePrivate
 
 	Quad gpQuad;
 
+	SpriteBatch spriteBatch;
+
+	GpuTimer gpuTimer;
+
 	unsigned int stampCounter;
 
 	SharedStatePrivate(RGSSThreadData *threadData)
 	    : bindingData(0),
 	      sdlWindow(threadData->window),
-	      fileSystem(threadData->argv0, threadData->config.allowSymlinks),
+	      fileSystem(threadData->argv0, threadData->config.allowSymlinks,
+	                 threadData->config.mmapArchives),
 	      eThread(*threadData->ethread),
 	      rtData(*threadData),
 	      config(threadData->config),
@@ -110,7 +135,15 @@ struct SharedStatePrivate
 	      input(*threadData),
 	      audio(*threadData),
 	      _glState(threadData->config),
+	      shaders(threadData->config),
+	      texPool(cacheSizeBytes(threadData->config.texturePoolSize)),
+	      bitmapCache(cacheSizeBytes(threadData->config.bitmapCacheSize)),
+	      bitmapLoader(threadData->config.preloadThreads, texPool, bitmapCache),
+	      bitmapAtlas(texPool, threadData->config.bitmapAtlas),
+	      textCache(cacheSizeBytes(threadData->config.textCacheSize)),
 	      fontState(threadData->config),
+	      spriteBatch(threadData->config.spriteBatching),
+	      gpuTimer(threadData->config.gpuTimers),
 	      stampCounter(0)
 	{
 		/* Shaders have been compiled in ShaderSet's constructor */
@@ -124,7 +157,15 @@ struct SharedStatePrivate
 			fileSystem.addPath(config.rtps[i].c_str());
 
 		if (config.pathCache)
-			fileSystem.createPathCache();
+		{
+			std::string indexDir;
+
+			if (config.pathCacheIndex)
+				indexDir = config.customDataPath.empty() ?
+					config.commonDataPath : config.customDataPath;
+
+			fileSystem.createPathCache(indexDir);
+		}
 
 		fileSystem.initFontSets(fontState);
 		globalTexW = 128;
@@ -222,7 +263,13 @@ GSATT(Audio&, audio)
 GSATT(GLState&, _glState)
 GSATT(ShaderSet&, shaders)
 GSATT(TexPool&, texPool)
+GSATT(BitmapCache&, bitmapCache)
+GSATT(BitmapAtlas&, bitmapAtlas)
+GSATT(TextCache&, textCache)
+GSATT(BitmapLoader&, bitmapLoader)
 GSATT(Quad&, gpQuad)
+GSATT(SpriteBatch&, spriteBatch)
+GSATT(GpuTimer&, gpuTimer)
 GSATT(SharedFontState&, fontState)
 GSATT(SharedMidiState&, midiState)
 
@@ -344,6 +391,10 @@ SharedState::SharedState(RGSSThreadData *threadData)
 {
 	p = new SharedStatePrivate(threadData);
 	p->screen = p->graphics.getScreen();
+
+	/* Upload preloaded images before each frame */
+	prepareDraw.connect
+	        (sigc::mem_fun(p->bitmapLoader, &BitmapLoader::processFinished));
 }
 
 SharedState::~SharedState()
@@ -35,6 +35,8 @@ struct SDL_Window;
 struct TEXFBO;
 struct Quad;
 struct ShaderSet;
+class SpriteBatch;
+class GpuTimer;
 
 class Scene;
 class FileSystem;
@@ -44,6 +46,10 @@ class Input;
 class Audio;
 class GLState;
 class TexPool;
+class BitmapCache;
+class BitmapAtlas;
+class TextCache;
+class BitmapLoader;
 class Font;
 class SharedFontState;
 struct GlobalIBO;
@@ -76,6 +82,10 @@ struct SharedState
 	ShaderSet &shaders() const;
 
 	TexPool &texPool() const;
+	BitmapCache &bitmapCache() const;
+	BitmapAtlas &bitmapAtlas() const;
+	TextCache &textCache() const;
+	BitmapLoader &bitmapLoader() const;
 
 	SharedFontState &fontState() const;
 	Font &defaultFont() const;
@@ -99,6 +109,10 @@ struct SharedState
 
 	Quad &gpQuad() const;
 
+	SpriteBatch &spriteBatch() const;
+
+	GpuTimer &gpuTimer() const;
+
 	/* Basically just a simple "TexPool"
 	 * replacement for Tilemap atlas use */
 	void requestAtlasTex(int w, int h, TEXFBO &out);
@@ -33,6 +33,7 @@
 #include "shader.h"
 #include "glstate.h"
 #include "quadarray.h"
+#include "spritebatch.h"
 
 #include <math.h>
 #ifndef M_PI
@@ -55,7 +56,8 @@ struct SpritePrivate
 
 	bool mirrored;
 	int bushDepth;
-	float efBushDepth;
+	/* Bitmap row where the bush starts */
+	float bushRow;
 	NormValue bushOpacity;
 	NormValue opacity;
 	BlendType blendType;
@@ -93,7 +95,7 @@ struct SpritePrivate
 	      srcRect(&tmp.rect),
 	      mirrored(false),
 	      bushDepth(0),
-	      efBushDepth(0),
+	      bushRow(0),
 	      bushOpacity(128),
 	      opacity(255),
 	      blendType(BlendNormal),
@@ -127,12 +129,13 @@ struct SpritePrivate
 		if (nullOrDisposed(bitmap))
 			return;
 
-		/* Calculate effective (normalized) bush depth */
+		/* Calculate effective bush depth in bitmap rows,
+		 * normalized against the bound texture on draw */
 		float texBushDepth = (bushDepth / trans.getScale().y) -
 		                     (srcRect->y + srcRect->height) +
 		                     bitmap->height();
 
-		efBushDepth = 1.0f - texBushDepth / bitmap->height();
+		bushRow = bitmap->height() - texBushDepth;
 	}
 
 	void onSrcRectChange()
@@ -144,7 +147,19 @@ struct SpritePrivate
 			bmSize = Vec2i(bitmap->width(), bitmap->height());
 
 		/* Clamp the rectangle so it doesn't reach outside
-		 * the bitmap bounds */
+		 * the bitmap bounds (atlas entries have neighbours) */
+		if (rect.x < 0)
+		{
+			rect.w += rect.x;
+			rect.x = 0;
+		}
+
+		if (rect.y < 0)
+		{
+			rect.h += rect.y;
+			rect.y = 0;
+		}
+
 		rect.w = clamp<int>(rect.w, 0, bmSize.x-rect.x);
 		rect.h = clamp<int>(rect.h, 0, bmSize.y-rect.y);
 
@@ -539,7 +554,6 @@ void Sprite::draw()
 
 		shader.setTone(p->tone->norm);
 		shader.setOpacity(p->opacity.norm);
-		shader.setBushDepth(p->efBushDepth);
 		shader.setBushOpacity(p->bushOpacity.norm);
 
 		/* When both flashing and effective color are set,
@@ -573,7 +587,13 @@ void Sprite::draw()
 
 	glState.blendMode.pushSet(p->blendType);
 
-	p->bitmap->bindTex(*base);
+	Vec2i texOffset, texSize;
+	p->bitmap->bindTex(*base, &texOffset, &texSize);
+
+	/* The bitmap may live in an atlas page, so compare
+	 * against the page's texture coordinates */
+	if (renderEffect)
+		shState->shaders().sprite.setBushDepth((texOffset.y + p->bushRow) / texSize.y);
 
 	if (p->wave.active)
 		p->wave.qArray.draw();
@@ -583,6 +603,40 @@ void Sprite::draw()
 	glState.blendMode.pop();
 }
 
+bool Sprite::drawBatched(SpriteBatch &batch)
+{
+	if (!p->isVisible)
+		return true;
+
+	if (emptyFlashFlag)
+		return true;
+
+	/* Wave chunks and the bush effect need their
+	 * own geometry / uniforms, fall back to 'draw()' */
+	if (!batch.isEnabled() || p->wave.active || p->bushDepth != 0)
+		return false;
+
+	bool renderEffect = p->color->hasEffect() ||
+	                    p->tone->hasEffect()  ||
+	                    flashing;
+
+	Vec4 tone, color;
+
+	/* Mirror the shader selection in 'draw()': without an
+	 * active effect, tone and color are left out entirely */
+	if (renderEffect)
+	{
+		tone = p->tone->norm;
+		color = (flashing && flashColor.w > p->color->norm.w) ?
+		        flashColor : p->color->norm;
+	}
+
+	batch.add(*p->bitmap, p->blendType, p->trans.getMatrix(),
+	          p->quad.vert, tone, color, p->opacity.norm);
+
+	return true;
+}
+
 void Sprite::onGeometryChange(const Scene::Geometry &geo)
 {
 	/* Offset at which the sprite will be drawn
@@ -73,6 +73,8 @@ private:
 	SpritePrivate *p;
 
 	void draw();
+	bool drawBatched(SpriteBatch &batch);
+	GpuTimer::Category gpuCategory() const { return GpuTimer::Sprites; }
 	void onGeometryChange(const Scene::Geometry &);
 
 	void releaseResources();
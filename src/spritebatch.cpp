@@ -0,0 +1,125 @@
+/*
+** spritebatch.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "spritebatch.h"
+
+#include "sharedstate.h"
+#include "global-ibo.h"
+#include "shader.h"
+#include "glstate.h"
+#include "bitmap.h"
+#include "util.h"
+#include "gputimer.h"
+
+/* Quads per draw call; must stay well within
+ * the index range of the global IBO */
+static const size_t batchQuadsMax = 2048;
+
+SpriteBatch::SpriteBatch(bool enabled)
+    : tex(0),
+      blendType(BlendNormal),
+      enabled(enabled)
+{
+	vertices.reserve(batchQuadsMax * 4);
+
+	vbo = VBO::gen();
+
+	GLMeta::vaoFillInVertexData<BVertex>(vao);
+	vao.vbo = vbo;
+	vao.ibo = shState->globalIBO().ibo;
+
+	GLMeta::vaoInit(vao);
+
+	shState->ensureQuadIBO(batchQuadsMax);
+}
+
+SpriteBatch::~SpriteBatch()
+{
+	GLMeta::vaoFini(vao);
+	VBO::del(vbo);
+}
+
+void SpriteBatch::add(Bitmap &bitmap, BlendType blendType,
+                      const float mat[16], const Vertex quad[4],
+                      const Vec4 &tone, const Vec4 &color, float opacity)
+{
+	Vec2i offset;
+	TEXFBO &source = bitmap.texSource(offset);
+
+	if (!vertices.empty())
+		if (source.tex != tex || blendType != this->blendType ||
+		    vertices.size() >= batchQuadsMax * 4)
+			flush();
+
+	tex = source.tex;
+	texSize = Vec2i(source.width, source.height);
+	this->blendType = blendType;
+
+	for (size_t i = 0; i < 4; ++i)
+	{
+		const Vec2 &pos = quad[i].pos;
+		BVertex v;
+
+		/* Same as 'spriteMat * vec4(pos, 0, 1)' in sprite.vert */
+		v.pos.x = mat[0] * pos.x + mat[4] * pos.y + mat[12];
+		v.pos.y = mat[1] * pos.x + mat[5] * pos.y + mat[13];
+		v.texPos.x = quad[i].texPos.x + offset.x;
+		v.texPos.y = quad[i].texPos.y + offset.y;
+		v.color = color;
+		v.tone = tone;
+		v.opacity = opacity;
+
+		vertices.push_back(v);
+	}
+}
+
+void SpriteBatch::flush()
+{
+	if (vertices.empty())
+		return;
+
+	GpuTimerScope gpuScope(shState->gpuTimer(), GpuTimer::Sprites);
+
+	SpriteBatchShader &shader = shState->shaders().spriteBatch;
+	shader.bind();
+	shader.applyViewportProj();
+
+	glState.blendMode.pushSet(blendType);
+
+	TEX::bind(tex);
+	shader.setTexSize(texSize);
+
+	/* Orphan the previous storage so we never
+	 * wait on a draw still using it */
+	VBO::bind(vbo);
+	VBO::uploadData(vertices.size() * sizeof(BVertex),
+	                dataPtr(vertices), GL_STREAM_DRAW);
+	VBO::unbind();
+
+	GLMeta::vaoBind(vao);
+	gl.DrawElements(GL_TRIANGLES, (vertices.size() / 4) * 6, _GL_INDEX_TYPE, 0);
+	GLMeta::vaoUnbind(vao);
+
+	glState.blendMode.pop();
+
+	vertices.clear();
+	tex = TEX::ID(0);
+}
@@ -0,0 +1,73 @@
+/*
+** spritebatch.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include "vertex.h"
+#include "gl-util.h"
+#include "gl-meta.h"
+#include "etc.h"
+
+#include <vector>
+
+class Bitmap;
+
+/* Collects consecutive sprite quads sharing the same texture
+ * and blend mode, and submits them in a single draw call.
+ * Bitmaps living on the same atlas page count as the same
+ * texture; their offset is baked into the texture coordinates.
+ * The sprite transform is applied on the CPU, and tone, color
+ * and opacity are passed in per vertex instead of as uniforms.
+ *
+ * Queued quads are only valid until the next 'flush()', which
+ * Scene::composite() issues before drawing any element that
+ * can't be batched, and at the end of each scene */
+class SpriteBatch
+{
+public:
+	SpriteBatch(bool enabled);
+	~SpriteBatch();
+
+	bool isEnabled() const { return enabled; }
+
+	/* 'quad' holds the untransformed sprite vertices,
+	 * 'mat' the sprite transform matrix */
+	void add(Bitmap &bitmap, BlendType blendType,
+	         const float mat[16], const Vertex quad[4],
+	         const Vec4 &tone, const Vec4 &color, float opacity);
+
+	void flush();
+
+private:
+	std::vector<BVertex> vertices;
+
+	VBO::ID vbo;
+	GLMeta::VAO vao;
+
+	TEX::ID tex;
+	Vec2i texSize;
+	BlendType blendType;
+
+	bool enabled;
+};
+
+#endif // SPRITEBATCH_H
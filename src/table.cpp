@@ -31,12 +31,14 @@
 /* Init normally */
 Table::Table(int x, int y /*= 1*/, int z /*= 1*/)
     : xs(x), ys(y), zs(z),
-      data(x*y*z)
+      data(x*y*z),
+      modRegion()
 {}
 
 Table::Table(const Table &other)
     : xs(other.xs), ys(other.ys), zs(other.zs),
-      data(other.data)
+      data(other.data),
+      modRegion()
 {}
 
 int16_t Table::get(int x, int y, int z) const
@@ -53,7 +55,26 @@ void Table::set(int16_t value, int x, int y, int z)
 		return;
 	}
 
-	data[xs*ys*z + xs*y + x] = value;
+	int16_t &cell = data[xs*ys*z + xs*y + x];
+
+	/* Rewriting a cell with the same value is common
+	 * and doesn't need to cause any work downstream */
+	if (cell == value)
+		return;
+
+	cell = value;
+
+	notifyModified(x, y, z, 1, 1, 1);
+}
+
+void Table::notifyModified(int x, int y, int z, int w, int h, int d)
+{
+	modRegion.x = x;
+	modRegion.y = y;
+	modRegion.z = z;
+	modRegion.w = w;
+	modRegion.h = h;
+	modRegion.d = d;
 
 	modified();
 }
@@ -79,6 +100,81 @@ void Table::resize(int x, int y, int z)
 	return;
 }
 
+void Table::fill(int16_t value, int x, int y, int z, int w, int h, int d)
+{
+	int x1 = std::min(x + w, xs);
+	int y1 = std::min(y + h, ys);
+	int z1 = std::min(z + d, zs);
+
+	x = std::max(x, 0);
+	y = std::max(y, 0);
+	z = std::max(z, 0);
+
+	if (x >= x1 || y >= y1 || z >= z1)
+		return;
+
+	for (int k = z; k < z1; ++k)
+		for (int j = y; j < y1; ++j)
+		{
+			int16_t *row = &at(0, j, k);
+			std::fill(row + x, row + x1, value);
+		}
+
+	notifyModified(x, y, z, x1 - x, y1 - y, z1 - z);
+}
+
+void Table::fill(int16_t value)
+{
+	fill(value, 0, 0, 0, xs, ys, zs);
+}
+
+void Table::copyRect(const Table &src, int srcX, int srcY,
+                     int w, int h, int dstX, int dstY)
+{
+	/* Clip against both tables */
+	int clipX = std::max(-srcX, -dstX);
+	int clipY = std::max(-srcY, -dstY);
+
+	if (clipX > 0)
+	{
+		srcX += clipX;
+		dstX += clipX;
+		w -= clipX;
+	}
+
+	if (clipY > 0)
+	{
+		srcY += clipY;
+		dstY += clipY;
+		h -= clipY;
+	}
+
+	w = std::min(w, std::min(src.xs - srcX, xs - dstX));
+	h = std::min(h, std::min(src.ys - srcY, ys - dstY));
+
+	int d = std::min(zs, src.zs);
+
+	if (w <= 0 || h <= 0 || d <= 0)
+		return;
+
+	/* Go through a temporary buffer so
+	 * overlapping self copies work */
+	std::vector<int16_t> buffer(w * h * d);
+	int16_t *bufferP = dataPtr(buffer);
+
+	for (int k = 0; k < d; ++k)
+		for (int j = 0; j < h; ++j, bufferP += w)
+			memcpy(bufferP, &src.at(srcX, srcY + j, k), w * sizeof(int16_t));
+
+	bufferP = dataPtr(buffer);
+
+	for (int k = 0; k < d; ++k)
+		for (int j = 0; j < h; ++j, bufferP += w)
+			memcpy(&at(dstX, dstY + j, k), bufferP, w * sizeof(int16_t));
+
+	notifyModified(dstX, dstY, 0, w, h, d);
+}
+
 void Table::resize(int x, int y)
 {
 	resize(x, y, zs);
@@ -47,6 +47,15 @@ public:
 	void resize(int x, int y);
 	void resize(int x);
 
+	/* Bulk operations, clipped to the table bounds.
+	 * Each one emits 'modified' only once */
+	void fill(int16_t value, int x, int y, int z, int w, int h, int d);
+	void fill(int16_t value);
+	/* Copies all z layers the tables have in common;
+	 * 'src' may be this table */
+	void copyRect(const Table &src, int srcX, int srcY,
+	              int w, int h, int dstX, int dstY);
+
 	int serialSize() const;
 	void serialize(char *buffer) const;
 	static Table *deserialize(const char *data, int len);
@@ -62,11 +71,30 @@ public:
 		return data[xs*ys*z + xs*y + x];
 	}
 
+	/* Box of cells (x, y, z, width, height, depth) */
+	struct Region
+	{
+		int x, y, z;
+		int w, h, d;
+	};
+
+	/* The cells affected by the change 'modified' is
+	 * currently being emitted for, so listeners can
+	 * update only what's necessary */
+	const Region &modifiedRegion() const
+	{
+		return modRegion;
+	}
+
 	sigc::signal<void> modified;
 
 private:
+	void notifyModified(int x, int y, int z, int w, int h, int d);
+
 	int xs, ys, zs;
 	std::vector<int16_t> data;
+
+	Region modRegion;
 };
 
 #endif // TABLE_H
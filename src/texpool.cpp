@@ -24,40 +24,68 @@
 #include "sharedstate.h"
 #include "glstate.h"
 #include "boost-hash.h"
+#include "intrulist.h"
 #include "debugwriter.h"
+#include "tracer.h"
 
-#include <list>
 #include <utility>
 #include <assert.h>
 #include <string.h>
 
 typedef std::pair<uint16_t, uint16_t> Size;
 
-static uint32_t byteCount(Size &s)
+/* Textures are bucketed by their dimensions rounded up
+ * to this granularity, so that requests of similar (but
+ * not identical) size can recycle each other's objects */
+static const int sizeClassGranularity = 16;
+
+static Size sizeClass(int width, int height)
 {
-	return s.first * s.second * 4;
+	return Size((width  + sizeClassGranularity - 1) / sizeClassGranularity,
+	            (height + sizeClassGranularity - 1) / sizeClassGranularity);
+}
+
+static uint32_t byteCount(int width, int height)
+{
+	return width * height * 4;
 }
 
 struct CacheNode
 {
 	TEXFBO obj;
-	std::list<TEXFBO>::iterator prioIter;
 
-	bool operator==(const CacheNode &o) const
-	{
-		return obj == o.obj;
-	}
+	/* Link into the global release order list */
+	IntruListLink<CacheNode> prioLink;
+
+	/* Link into the size class bucket */
+	IntruListLink<CacheNode> bucketLink;
+
+	/* Link into the exact size list */
+	IntruListLink<CacheNode> sizeLink;
+
+	CacheNode(const TEXFBO &obj)
+	    : obj(obj),
+	      prioLink(this),
+	      bucketLink(this),
+	      sizeLink(this)
+	{}
 };
 
-typedef std::list<CacheNode> CNodeList;
+typedef IntruList<CacheNode> CNodeList;
 
 struct TexPoolPrivate
 {
-	/* Contains all cached TexFBOs, grouped by size */
-	BoostHash<Size, CNodeList> poolHash;
+	/* Contains all cached TexFBOs, grouped by size class.
+	 * Most recently released objects are at the front */
+	BoostHash<Size, CNodeList*> poolHash;
+
+	/* Contains all cached TexFBOs, grouped by exact size.
+	 * Most recently released objects are at the front */
+	BoostHash<Size, CNodeList*> sizeHash;
 
-	/* Contains all cached TexFBOs, sorted by release time */
-	std::list<TEXFBO> priorityQueue;
+	/* Contains all cached TexFBOs, sorted by release time
+	 * (most recent first) */
+	CNodeList priorityQueue;
 
 	/* Maximal allowed cache memory */
 	const uint32_t maxMemSize;
@@ -65,18 +93,93 @@ struct TexPoolPrivate
 	/* Current amound of memory consumed by the cache */
 	uint32_t memSize;
 
-	/* Current amount of TexFBOs cached */
-	uint16_t objCount;
-
 	/* Has this pool been disabled? */
 	bool disabled;
 
+	/* Statistics */
+	uint64_t requests;
+	uint64_t hits;
+	uint64_t reuses;
+	uint64_t evictions;
+
 	TexPoolPrivate(uint32_t maxMemSize)
 	    : maxMemSize(maxMemSize),
 	      memSize(0),
-	      objCount(0),
-	      disabled(false)
+	      disabled(false),
+	      requests(0),
+	      hits(0),
+	      reuses(0),
+	      evictions(0)
 	{}
+
+	~TexPoolPrivate()
+	{
+		BoostHash<Size, CNodeList*>::const_iterator iter;
+		for (iter = poolHash.cbegin(); iter != poolHash.cend(); ++iter)
+			delete iter->second;
+		for (iter = sizeHash.cbegin(); iter != sizeHash.cend(); ++iter)
+			delete iter->second;
+	}
+
+	static CNodeList &getList(BoostHash<Size, CNodeList*> &hash, const Size &key)
+	{
+		CNodeList *&list = hash[key];
+
+		if (!list)
+			list = new CNodeList;
+
+		return *list;
+	}
+
+	/* Unlinks 'link' from the list at 'key', freeing the
+	 * list once it runs empty so the hashes only ever hold
+	 * sizes that currently have cached objects */
+	static void unlink(BoostHash<Size, CNodeList*> &hash, const Size &key,
+	                   IntruListLink<CacheNode> &link)
+	{
+		CNodeList *list = hash.value(key);
+		list->remove(link);
+
+		if (list->isEmpty())
+		{
+			hash.remove(key);
+			delete list;
+		}
+	}
+
+	static CacheNode *front(const BoostHash<Size, CNodeList*> &hash, const Size &key)
+	{
+		CNodeList *list = hash.value(key);
+
+		return list ? list->begin()->data : 0;
+	}
+
+	CNodeList &getBucket(const Size &cls)
+	{
+		return getList(poolHash, cls);
+	}
+
+	CNodeList &getSizeList(int width, int height)
+	{
+		return getList(sizeHash, Size(width, height));
+	}
+
+	/* Unlinks 'node' from both lists and frees it,
+	 * returning the contained object */
+	TEXFBO take(CacheNode *node)
+	{
+		TEXFBO obj = node->obj;
+		Size cls = sizeClass(obj.width, obj.height);
+
+		unlink(poolHash, cls, node->bucketLink);
+		unlink(sizeHash, Size(obj.width, obj.height), node->sizeLink);
+		priorityQueue.remove(node->prioLink);
+		delete node;
+
+		memSize -= byteCount(obj.width, obj.height);
+
+		return obj;
+	}
 };
 
 TexPool::TexPool(uint32_t maxMemSize)
@@ -86,64 +189,73 @@ TexPool::TexPool(uint32_t maxMemSize)
 
 TexPool::~TexPool()
 {
-	std::list<TEXFBO>::iterator iter;
-
-	for (iter = p->priorityQueue.begin();
-	     iter != p->priorityQueue.end();
-	     ++iter)
+	while (!p->priorityQueue.isEmpty())
 	{
-		TEXFBO obj = *iter;
+		TEXFBO obj = p->take(p->priorityQueue.tail());
 		TEXFBO::fini(obj);
-		--p->objCount;
 	}
 
-	assert(p->objCount == 0);
+	assert(p->memSize == 0);
 
 	delete p;
 }
 
 TEXFBO TexPool::request(int width, int height)
 {
-	CacheNode cnode;
-	Size size(width, height);
+	TRACE_SCOPE("TexPool::request");
+
+	int maxSize = glState.caps.maxTexSize;
+	if (width > maxSize || height > maxSize)
+		throw Exception(Exception::MKXPError,
+		                "Texture dimensions [%d, %d] exceed hardware capabilities",
+		                width, height);
 
-	/* See if we can statisfy request from cache */
-	CNodeList &bucket = p->poolHash[size];
+	++p->requests;
 
-	if (!bucket.empty())
-	{
-		/* Found one! */
-		cnode = bucket.back();
-		bucket.pop_back();
+	/* See if we can statisfy request from cache. Prefer an
+	 * object of the exact size, falling back to the most
+	 * recently released one of this class */
+	CacheNode *match = TexPoolPrivate::front(p->sizeHash, Size(width, height));
 
-		p->priorityQueue.erase(cnode.prioIter);
+	if (!match)
+		match = TexPoolPrivate::front(p->poolHash, sizeClass(width, height));
 
-		p->memSize -= byteCount(size);
-		--p->objCount;
+	if (match)
+	{
+		TEXFBO obj = p->take(match);
+
+		if (obj.width == width && obj.height == height)
+		{
+			++p->hits;
+		}
+		else
+		{
+			/* Respecify the storage in place; the texture and
+			 * FBO names as well as the attachment survive */
+			TEXFBO::allocEmpty(obj, width, height);
+			++p->reuses;
+		}
 
 //		Debug() << "TexPool: <?+> (" << width << height << ")";
 
-		return cnode.obj;
+		return obj;
 	}
 
-	int maxSize = glState.caps.maxTexSize;
-	if (width > maxSize || height > maxSize)
-		throw Exception(Exception::MKXPError,
-		                "Texture dimensions [%d, %d] exceed hardware capabilities",
-		                width, height);
-
 	/* Nope, create it instead */
-	TEXFBO::init(cnode.obj);
-	TEXFBO::allocEmpty(cnode.obj, width, height);
-	TEXFBO::linkFBO(cnode.obj);
+	TEXFBO obj;
+	TEXFBO::init(obj);
+	TEXFBO::allocEmpty(obj, width, height);
+	TEXFBO::linkFBO(obj);
 
 //	Debug() << "TexPool: <?-> (" << width << height << ")";
 
-	return cnode.obj;
+	return obj;
 }
 
 void TexPool::release(TEXFBO &obj)
 {
+	TRACE_SCOPE("TexPool::release");
+
 	if (obj.tex == TEX::ID(0) || obj.fbo == FBO::ID(0))
 	{
 		TEXFBO::fini(obj);
@@ -158,52 +270,36 @@ void TexPool::release(TEXFBO &obj)
 		return;
 	}
 
-	Size size(obj.width, obj.height);
+	uint32_t objSize = byteCount(obj.width, obj.height);
 
-	uint32_t newMemSize = p->memSize + byteCount(size);
+	if (objSize > p->maxMemSize)
+	{
+		TEXFBO::fini(obj);
+		return;
+	}
 
 	/* If caching this object would spill over the allowed memory budget,
 	 * delete least used objects until we're good again */
-	while (newMemSize > p->maxMemSize)
+	while (p->memSize + objSize > p->maxMemSize)
 	{
-		if (p->objCount == 0)
-			break;
-
 //		Debug() << "TexPool: <!~> Size:" << p->memSize;
 
 		/* Retrieve object with lowest priority for deletion */
-		CacheNode last;
-		last.obj = p->priorityQueue.back();
-		Size removedSize(last.obj.width, last.obj.height);
+		TEXFBO last = p->take(p->priorityQueue.tail());
+		TEXFBO::fini(last);
 
-		CNodeList &bucket = p->poolHash[removedSize];
+		++p->evictions;
 
-		std::list<CacheNode>::iterator toRemove =
-		        std::find(bucket.begin(), bucket.end(), last);
-		assert(toRemove != bucket.end());
-		bucket.erase(toRemove);
-
-		p->priorityQueue.pop_back();
-
-		TEXFBO::fini(last.obj);
-
-		newMemSize -= byteCount(removedSize);
-		--p->objCount;
-
-//		Debug() << "TexPool: <!-> (" << last.obj.width << last.obj.height << ")";
+//		Debug() << "TexPool: <!-> (" << last.width << last.height << ")";
 	}
 
-	p->memSize = newMemSize;
+	p->memSize += objSize;
 
 	/* Retain object */
-	p->priorityQueue.push_front(obj);
-	CacheNode cnode;
-	cnode.obj = obj;
-	cnode.prioIter = p->priorityQueue.begin();
-	CNodeList &bucket = p->poolHash[size];
-	bucket.push_back(cnode);
-
-	++p->objCount;
+	CacheNode *node = new CacheNode(obj);
+	p->priorityQueue.prepend(node->prioLink);
+	p->getBucket(sizeClass(obj.width, obj.height)).prepend(node->bucketLink);
+	p->getSizeList(obj.width, obj.height).prepend(node->sizeLink);
 
 //	Debug() << "TexPool: <!+> (" << obj.width << obj.height << ") Current size:" << p->memSize;
 }
@@ -213,4 +309,16 @@ void TexPool::disable()
 	p->disabled = true;
 }
 
-
+TexPool::Stats TexPool::getStats() const
+{
+	Stats stats;
+	stats.requests = p->requests;
+	stats.hits = p->hits;
+	stats.reuses = p->reuses;
+	stats.evictions = p->evictions;
+	stats.entries = p->priorityQueue.getSize();
+	stats.memSize = p->memSize;
+	stats.maxMemSize = p->maxMemSize;
+
+	return stats;
+}
@@ -37,6 +37,22 @@ public:
 
 	void disable();
 
+	struct Stats
+	{
+		uint64_t requests;
+		/* Requests served by a cached object of the exact size */
+		uint64_t hits;
+		/* Requests served by respecifying a cached object
+		 * of the same size class */
+		uint64_t reuses;
+		uint64_t evictions;
+		uint32_t entries;
+		uint32_t memSize;
+		uint32_t maxMemSize;
+	};
+
+	Stats getStats() const;
+
 private:
 	TexPoolPrivate *p;
 };
@@ -0,0 +1,165 @@
+/*
+** textcache.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textcache.h"
+#include "boost-hash.h"
+
+#include <SDL_surface.h>
+#include <SDL_pixels.h>
+
+#include <list>
+#include <string.h>
+
+struct TextEntry
+{
+	std::string key;
+
+	SDL_Surface *surf;
+	int rawHeight;
+	uint32_t memSize;
+};
+
+typedef std::list<TextEntry> TextEntryList;
+
+struct TextCachePrivate
+{
+	/* Most recently used entries at the front */
+	TextEntryList lru;
+	BoostHash<std::string, TextEntryList::iterator> entries;
+
+	const uint32_t maxMemSize;
+	uint32_t memSize;
+
+	TextCachePrivate(uint32_t maxMemSize)
+	    : maxMemSize(maxMemSize),
+	      memSize(0)
+	{}
+
+	void remove(TextEntryList::iterator iter)
+	{
+		SDL_FreeSurface(iter->surf);
+		memSize -= iter->memSize;
+
+		entries.remove(iter->key);
+		lru.erase(iter);
+	}
+
+	void evictFor(uint32_t required)
+	{
+		while (!lru.empty() && memSize + required > maxMemSize)
+			remove(--lru.end());
+	}
+};
+
+TextCache::TextCache(uint32_t maxMemSize)
+{
+	p = new TextCachePrivate(maxMemSize);
+}
+
+TextCache::~TextCache()
+{
+	clear();
+
+	delete p;
+}
+
+std::string TextCache::makeKey(_TTF_Font *font, int style,
+                               const SDL_Color &color,
+                               const SDL_Color &outColor,
+                               int flags, const std::string &text)
+{
+	/* Fixed size binary header followed by the text */
+	struct
+	{
+		_TTF_Font *font;
+		int32_t style;
+		int32_t flags;
+		uint8_t color[3];
+		uint8_t outColor[3];
+	} header;
+
+	memset(&header, 0, sizeof(header));
+
+	header.font = font;
+	header.style = style;
+	header.flags = flags;
+	header.color[0] = color.r;
+	header.color[1] = color.g;
+	header.color[2] = color.b;
+
+	/* Only affects the output with an outline */
+	if (flags & Outline)
+	{
+		header.outColor[0] = outColor.r;
+		header.outColor[1] = outColor.g;
+		header.outColor[2] = outColor.b;
+	}
+
+	std::string key(reinterpret_cast<const char*>(&header), sizeof(header));
+	key += text;
+
+	return key;
+}
+
+SDL_Surface *TextCache::lookup(const std::string &key, int &rawHeight)
+{
+	if (p->maxMemSize == 0 || !p->entries.contains(key))
+		return 0;
+
+	TextEntryList::iterator iter = p->entries[key];
+
+	/* Move to front */
+	p->lru.splice(p->lru.begin(), p->lru, iter);
+	rawHeight = iter->rawHeight;
+
+	return iter->surf;
+}
+
+bool TextCache::store(const std::string &key, SDL_Surface *surf, int rawHeight)
+{
+	uint32_t memSize = surf->pitch * surf->h + key.size();
+
+	if (memSize > p->maxMemSize)
+		return false;
+
+	TextEntry entry;
+	entry.key = key;
+	entry.surf = surf;
+	entry.rawHeight = rawHeight;
+	entry.memSize = memSize;
+
+	if (p->entries.contains(key))
+		p->remove(p->entries[key]);
+
+	p->evictFor(memSize);
+
+	p->lru.push_front(entry);
+	p->entries.insert(key, p->lru.begin());
+	p->memSize += memSize;
+
+	return true;
+}
+
+void TextCache::clear()
+{
+	while (!p->lru.empty())
+		p->remove(p->lru.begin());
+}
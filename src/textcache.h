@@ -0,0 +1,76 @@
+/*
+** textcache.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include <string>
+#include <stdint.h>
+
+struct SDL_Surface;
+struct SDL_Color;
+struct _TTF_Font;
+struct TextCachePrivate;
+
+/* Keeps rasterized text runs (with shadow and outline already
+ * applied) around, keyed by font handle, style, colors and the
+ * string itself. Message windows typically draw their text one
+ * character at a time, and menus redraw the same lines over and
+ * over, so most 'Bitmap::drawText()' calls can skip SDL_ttf,
+ * the CPU shadow pass and format conversion entirely.
+ * Entries are evicted in LRU order once the memory budget
+ * is exceeded */
+class TextCache
+{
+public:
+	enum Flags
+	{
+		Shadow  = 1 << 0,
+		Outline = 1 << 1,
+		Solid   = 1 << 2
+	};
+
+	TextCache(uint32_t maxMemSize);
+	~TextCache();
+
+	/* 'font' handles are pooled and never closed,
+	 * so they can serve as identity */
+	static std::string makeKey(_TTF_Font *font, int style,
+	                           const SDL_Color &color,
+	                           const SDL_Color &outColor,
+	                           int flags, const std::string &text);
+
+	/* Returns the cached surface for 'key', or null. 'rawHeight'
+	 * receives the text height before shadow / outline were added.
+	 * The surface stays owned by the cache and is only valid
+	 * until the next call to 'store()' */
+	SDL_Surface *lookup(const std::string &key, int &rawHeight);
+
+	/* Takes ownership of 'surf' if true is returned */
+	bool store(const std::string &key, SDL_Surface *surf, int rawHeight);
+
+	void clear();
+
+private:
+	TextCachePrivate *p;
+};
+
+#endif // TEXTCACHE_H
@@ -273,6 +273,12 @@ void build(TEXFBO &tf, Bitmap *bitmaps[BM_COUNT])
 {
 	assert(tf.width == ATLASVX_W && tf.height == ATLASVX_H);
 
+	/* Shared atlas residents can't be blit
+	 * sources inside the blit sequence */
+	for (size_t i = 0; i < BM_COUNT; ++i)
+		if (!nullOrDisposed(bitmaps[i]))
+			bitmaps[i]->ensureNonAtlas();
+
 	GLMeta::blitBegin(tf);
 
 	glState.clearColor.pushSet(Vec4());
@@ -604,24 +610,18 @@ onTile(Reader &reader, int16_t tileID,
 }
 
 static void
-readLayer(Reader &reader, const Table &data,
-          const Table *flags, int ox, int oy, int w, int h, int z)
+readLayerRow(Reader &reader, const Table &data,
+             const Table *flags, int ox, int oy, int w, int y, int z)
 {
-	/* The table autotile pattern (A2) has two quads (table
-	 * legs, etc.) which extend over the tile below. We process
-	 * the tiles in rows from bottom to top so the table extents
-	 * are added after the tile below and drawn over it. */
-
-	for (int y = h-1; y >= 0; --y)
-		for (int x = 0; x < w; ++x)
-		{
-			int16_t tileID = tableGetWrapped(data, x+ox, y+oy, z);
+	for (int x = 0; x < w; ++x)
+	{
+		int16_t tileID = tableGetWrapped(data, x+ox, y+oy, z);
 
-			if (tileID <= 0)
-				continue;
+		if (tileID <= 0)
+			continue;
 
-			onTile(reader, tileID, x, y, flags);
-		}
+		onTile(reader, tileID, x, y, flags);
+	}
 }
 
 static void
@@ -640,27 +640,54 @@ onShadowTile(Reader &reader, int8_t value,
 }
 
 static void
-readShadowLayer(Reader &reader, const Table &data,
-                int ox, int oy, int w, int h)
+readShadowRow(Reader &reader, const Table &data,
+              int ox, int oy, int w, int y)
 {
-	for (int y = 0; y < h; ++y)
-		for (int x = 0; x < w; ++x)
-		{
-			int16_t value = tableGetWrapped(data, x+ox, y+oy, 3);
-			onShadowTile(reader, value & 0xF, x, y);
-		}
+	for (int x = 0; x < w; ++x)
+	{
+		int16_t value = tableGetWrapped(data, x+ox, y+oy, 3);
+		onShadowTile(reader, value & 0xF, x, y);
+	}
+}
+
+void readRow(Reader &reader, const Table &data,
+             const Table *flags, int ox, int oy, int w, int y, int pass)
+{
+	switch (pass)
+	{
+	case PASS_LAYER0:
+		readLayerRow(reader, data, flags, ox, oy, w, y, 0);
+		break;
+	case PASS_LAYER1:
+		readLayerRow(reader, data, flags, ox, oy, w, y, 1);
+		break;
+	case PASS_SHADOW:
+		if (rgssVer >= 3)
+			readShadowRow(reader, data, ox, oy, w, y);
+		break;
+	case PASS_LAYER2:
+		readLayerRow(reader, data, flags, ox, oy, w, y, 2);
+		break;
+	}
 }
 
 void readTiles(Reader &reader, const Table &data,
                const Table *flags, int ox, int oy, int w, int h)
 {
-	for (int i = 0; i < 2; ++i)
-		readLayer(reader, data, flags, ox, oy, w, h, i);
-
-	if (rgssVer >= 3)
-		readShadowLayer(reader, data, ox, oy, w, h);
+	for (int pass = 0; pass < PASS_COUNT; ++pass)
+	{
+		/* The table autotile pattern (A2) has two quads (table
+		 * legs, etc.) which extend over the tile below. We process
+		 * the tiles in rows from bottom to top so the table extents
+		 * are added after the tile below and drawn over it. */
+		for (int i = 0; i < h; ++i)
+		{
+			int y = (pass == PASS_SHADOW) ? i : h-1 - i;
 
-	readLayer(reader, data, flags, ox, oy, w, h, 2);
+			reader.onRow(pass, y);
+			readRow(reader, data, flags, ox, oy, w, y, pass);
+		}
+	}
 }
 
 }
@@ -50,16 +50,36 @@ enum
 
 namespace TileAtlasVX
 {
+/* Passes of 'readTiles()', in drawing order */
+enum
+{
+	PASS_LAYER0 = 0,
+	PASS_LAYER1 = 1,
+	PASS_SHADOW = 2,
+	PASS_LAYER2 = 3,
+
+	PASS_COUNT
+};
+
 struct Reader
 {
 	virtual void onQuads(const FloatRect *t, const FloatRect *p,
 	                     size_t n, bool overPlayer) = 0;
+
+	/* Called by 'readTiles()' before reading each row of a pass */
+	virtual void onRow(int /*pass*/, int /*y*/) {}
 };
 
 void build(TEXFBO &tf, Bitmap *bitmaps[BM_COUNT]);
 
 void readTiles(Reader &reader, const Table &data,
                const Table *flags, int ox, int oy, int w, int h);
+
+/* Reads row 'y' of a single pass. Tiles only ever produce
+ * quads in the row they're read with, so rows can be read
+ * again on their own */
+void readRow(Reader &reader, const Table &data,
+             const Table *flags, int ox, int oy, int w, int y, int pass);
 }
 
 #endif // TILEATLASVX_H
@@ -35,6 +35,7 @@
 
 #include <stdint.h>
 #include <assert.h>
+#include <algorithm>
 #include <vector>
 
 #include <sigc++/connection.h>
@@ -71,6 +72,60 @@ getTilePos(const Vec2i &pixelPos)
 	return (pixelPos & ~(32-1)) / 32;
 }
 
+/* Whether any value in [start, start+len) wraps
+ * into [dStart, dStart+dLen) modulo 'range' */
+static inline bool
+wrappedRangeHit(int start, int len, int dStart, int dLen, int range)
+{
+	if (len >= range)
+		return dLen > 0;
+
+	for (int i = start; i < start + len; ++i)
+	{
+		int w = wrap(i, range);
+
+		if (w >= dStart && w < dStart + dLen)
+			return true;
+	}
+
+	return false;
+}
+
+/* Accumulates the cell regions a Table reports as
+ * modified into one bounding rectangle (ignoring z) */
+struct TableDirtyRect
+{
+	IntRect rect;
+	bool dirty;
+
+	TableDirtyRect()
+	    : dirty(false)
+	{}
+
+	void add(const Table::Region &region)
+	{
+		if (!dirty)
+		{
+			rect = IntRect(region.x, region.y, region.w, region.h);
+			dirty = true;
+			return;
+		}
+
+		int x1 = std::max(rect.x + rect.w, region.x + region.w);
+		int y1 = std::max(rect.y + rect.h, region.y + region.h);
+
+		rect.x = std::min(rect.x, region.x);
+		rect.y = std::min(rect.y, region.y);
+		rect.w = x1 - rect.x;
+		rect.h = y1 - rect.y;
+	}
+
+	void clear()
+	{
+		dirty = false;
+	}
+};
+
 enum AtSubPos
 {
 	TopLeft          = 0,
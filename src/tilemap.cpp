@@ -63,11 +63,13 @@ static const int atAreaH = autotileH * autotileCount;
 
 static const int tsLaneW = tilesetW / 2;
 
-/* Map viewport size */
-static const int viewpW = 21;
-static const int viewpH = 16;
+/* Map viewport size at the default resolution (640x480) */
+static const int viewpDefW = 21;
+static const int viewpDefH = 16;
 
-static const size_t zlayersMax = viewpH + 5;
+/* Upper limit for the quads in the shared buffer, so
+ * they can still be addressed via the global IBO */
+static const size_t quadsMax = INDEX_T_MAX / 6 - 1;
 
 /* Vocabulary:
  *
@@ -147,10 +149,21 @@ static const size_t zlayersMax = viewpH + 5;
  *
  * Map viewport:
  *   This rectangle describes the subregion of the map that is
- *   actually translated to vertices and stored on the GPU ready
- *   for rendering. Whenever, ox/oy are modified, its position is
- *   adjusted if necessary and the data is regenerated. Its size
- *   is fixed. This is NOT related to the RGSS Viewport class!
+ *   actually visible and drawn. Whenever ox/oy are modified, its
+ *   position is adjusted if necessary. Its size is derived from
+ *   the size of the scene the tilemap is drawn in (ie. the screen
+ *   or its viewport), and adjusted whenever that changes.
+ *   This is NOT related to the RGSS Viewport class!
+ *
+ * Build area:
+ *   The subregion of the map that is actually translated to
+ *   vertices and stored on the GPU ready for rendering. It spans
+ *   the map viewport plus a margin of tiles around it, so that
+ *   scrolling only has to adjust the drawn index ranges and the
+ *   translation, and the data is only regenerated once the map
+ *   viewport leaves the build area. Ground layer quads are stored
+ *   row by row, and there is one zlayer per built row, so the
+ *   visible part of each is a contiguous index range.
  *
  */
 
@@ -180,16 +193,20 @@ static elementsN(flashAlpha);
 
 struct GroundLayer : public ViewportElement
 {
-	GLsizei vboCount;
+	/* Drawn range in quads */
+	size_t vboFirst;
+	size_t vboCount;
 	TilemapPrivate *p;
 
 	GroundLayer(TilemapPrivate *p, Viewport *viewport);
 
-	void updateVboCount();
+	void updateVboRange(int firstRow, int rowCount);
 
 	void draw();
 	void drawInt();
 
+	GpuTimer::Category gpuCategory() const { return GpuTimer::Tilemaps; }
+
 	void onGeometryChange(const Scene::Geometry &geo);
 
 	ABOUT_TO_ACCESS_NOOP
@@ -198,8 +215,9 @@ struct GroundLayer : public ViewportElement
 struct ZLayer : public ViewportElement
 {
 	size_t index;
-	GLintptr vboOffset;
-	GLsizei vboCount;
+	/* Drawn range in quads */
+	size_t vboFirst;
+	size_t vboCount;
 	TilemapPrivate *p;
 
 	/* If this layer is part of a batch and not
@@ -207,8 +225,8 @@ struct ZLayer : public ViewportElement
 	bool batchedFlag;
 
 	/* If this layer is a batch head, this variable
-	 * holds the element count of the entire batch */
-	GLsizei vboBatchCount;
+	 * holds the quad count of the entire batch */
+	size_t vboBatchCount;
 
 	ZLayer(TilemapPrivate *p, Viewport *viewport);
 
@@ -217,6 +235,8 @@ struct ZLayer : public ViewportElement
 	void draw();
 	void drawInt();
 
+	GpuTimer::Category gpuCategory() const { return GpuTimer::Tilemaps; }
+
 	static int calculateZ(TilemapPrivate *p, int index);
 
 	void initUpdateZ();
@@ -258,18 +278,37 @@ struct TilemapPrivate
 		std::vector<uint8_t> animatedATs;
 	} atlas;
 
-	/* Map viewport position */
+	/* Map viewport position and size */
 	Vec2i viewpPos;
+	Vec2i viewpSize;
+
+	/* Build area, always contains the map viewport */
+	IntRect buildRect;
+
+	/* Tiles built in each direction around the map viewport */
+	int buildMargin;
 
 	/* Ground layer vertices */
 	SVVector groundVert;
 
-	/* ZLayer vertices */
-	SVVector zlayerVert[zlayersMax];
+	/* Base quad indices of each built row
+	 * in the ground layer (plus end index) */
+	std::vector<size_t> groundRowBases;
+
+	/* ZLayer vertices (one per built row,
+	 * plus overhang for the highest priorities) */
+	std::vector<SVVector> zlayerVert;
 
 	/* Base quad indices of each zlayer
-	 * in the shared buffer */
-	size_t zlayerBases[zlayersMax+1];
+	 * in the shared buffer (plus end index) */
+	std::vector<size_t> zlayerBases;
+
+	/* Base quad index (within the zlayer) of the tiles of each
+	 * built row and priority [1-5], ie. [row * 5 + prio - 1] */
+	std::vector<size_t> zlayerSegBases;
+
+	/* Cells of mapData changed since the last (re)build */
+	TableDirtyRect dirtyCells;
 
 	/* Shared buffers for all tiles */
 	struct
@@ -278,6 +317,9 @@ struct TilemapPrivate
 		VBO::ID vbo;
 		bool animated;
 
+		/* Quad capacity of the VBO */
+		size_t allocQuads;
+
 		/* Animation state */
 		uint8_t frameIdx;
 		uint8_t aniIdx;
@@ -291,7 +333,8 @@ struct TilemapPrivate
 	struct
 	{
 		GroundLayer *ground;
-		ZLayer* zlayers[zlayersMax];
+		/* Grown as needed, never shrunk */
+		std::vector<ZLayer*> zlayers;
 		/* Used layers out of 'zlayers' (rest is hidden) */
 		size_t activeLayers;
 		Scene::Geometry sceneGeo;
@@ -305,6 +348,8 @@ struct TilemapPrivate
 	bool buffersDirty;
 	/* Affected by: ox, oy */
 	bool mapViewportDirty;
+	/* Affected by: map viewport moving inside the build area */
+	bool layersDirty;
 	/* Affected by: oy */
 	bool zOrderDirty;
 
@@ -329,16 +374,20 @@ struct TilemapPrivate
 	      mapData(0),
 	      priorities(0),
 	      visible(true),
+	      viewpSize(viewpDefW, viewpDefH),
 	      flashAlphaIdx(0),
 	      atlasSizeDirty(false),
 	      atlasDirty(false),
 	      buffersDirty(false),
 	      mapViewportDirty(false),
+	      layersDirty(false),
 	      zOrderDirty(false),
 	      tilemapReady(false)
 	{
 		memset(autotiles, 0, sizeof(autotiles));
 
+		buildMargin = std::max(shState->config().tilemapBuildMargin, 0);
+
 		atlas.animatedATs.reserve(autotileCount);
 		atlas.efTilesetH = 0;
 
@@ -355,10 +404,10 @@ struct TilemapPrivate
 
 		GLMeta::vaoInit(tiles.vao);
 
-		elem.ground = new GroundLayer(this, viewport);
+		tiles.allocQuads = 0;
 
-		for (size_t i = 0; i < zlayersMax; ++i)
-			elem.zlayers[i] = new ZLayer(this, viewport);
+		elem.activeLayers = 0;
+		elem.ground = new GroundLayer(this, viewport);
 
 		prepareCon = shState->prepareDraw.connect
 		        (sigc::mem_fun(this, &TilemapPrivate::prepare));
@@ -370,7 +419,7 @@ struct TilemapPrivate
 	{
 		/* Destroy elements */
 		delete elem.ground;
-		for (size_t i = 0; i < zlayersMax; ++i)
+		for (size_t i = 0; i < elem.zlayers.size(); ++i)
 			delete elem.zlayers[i];
 
 		shState->releaseAtlasTex(atlas.gl);
@@ -394,7 +443,20 @@ struct TilemapPrivate
 
 	void updateFlashMapViewport()
 	{
-		flashMap.setViewport(IntRect(viewpPos, Vec2i(viewpW, viewpH)));
+		flashMap.setViewport(buildRect);
+	}
+
+	/* Translation of the build area origin on screen */
+	Vec2i buildOffset() const
+	{
+		return dispPos - (viewpPos - buildRect.pos()) * 32;
+	}
+
+	bool viewportInBuildArea() const
+	{
+		return viewpPos.x >= buildRect.x && viewpPos.y >= buildRect.y &&
+		       viewpPos.x + viewpSize.x <= buildRect.x + buildRect.w &&
+		       viewpPos.y + viewpSize.y <= buildRect.y + buildRect.h;
 	}
 
 	void updateAtlasInfo()
@@ -448,6 +510,22 @@ struct TilemapPrivate
 	{
 		elem.sceneGeo = geo;
 		mapViewportDirty = true;
+
+		/* Enough tiles to cover the scene at any sub-tile offset */
+		Vec2i size((geo.rect.w + 62) / 32, (geo.rect.h + 62) / 32);
+
+		if (size != viewpSize)
+		{
+			viewpSize = size;
+			buffersDirty = true;
+		}
+	}
+
+	/* Number of zlayers the map viewport can touch,
+	 * as tiles can be raised by up to 5 rows */
+	size_t zlayersMax() const
+	{
+		return viewpSize.y + 5;
 	}
 
 	void invalidateAtlasSize()
@@ -465,6 +543,11 @@ struct TilemapPrivate
 		buffersDirty = true;
 	}
 
+	void onMapDataModified()
+	{
+		dirtyCells.add(mapData->modifiedRegion());
+	}
+
 	/* Checks for the minimum amount of data needed to display */
 	bool verifyResources()
 	{
@@ -496,6 +579,13 @@ struct TilemapPrivate
 
 		TileAtlas::BlitVec blits = TileAtlas::calcBlits(atlas.efTilesetH, atlas.size);
 
+		/* Shared atlas residents can't be blit sources
+		 * inside the blit sequences below */
+		for (size_t i = 0; i < atlas.usableATs.size(); ++i)
+			autotiles[atlas.usableATs[i]]->ensureNonAtlas();
+
+		tileset->ensureNonAtlas();
+
 		/* Clear atlas */
 		FBO::bind(atlas.gl.fbo);
 		glState.clearColor.pushSet(Vec4());
@@ -646,10 +736,12 @@ struct TilemapPrivate
 		}
 	}
 
-	void handleTile(int x, int y, int z)
+	/* 'rowTargets' holds the arrays receiving the row's
+	 * tiles, indexed by priority (0 = ground layer) */
+	void handleTile(int x, int y, int z, SVVector *const *rowTargets)
 	{
 		int tileInd =
-			tableGetWrapped(*mapData, x + viewpPos.x, y + viewpPos.y, z);
+			tableGetWrapped(*mapData, x + buildRect.x, y + buildRect.y, z);
 
 		/* Check for empty space */
 		if (tileInd < 48)
@@ -661,18 +753,9 @@ struct TilemapPrivate
 		if (prio == -1)
 			return;
 
-		SVVector *targetArray;
-
-		/* Prio 0 tiles are all part of the same ground layer */
-		if (prio == 0)
-		{
-			targetArray = &groundVert;
-		}
-		else
-		{
-			int layerInd = y + prio;
-			targetArray = &zlayerVert[layerInd];
-		}
+		/* Prio 0 tiles are all part of the same ground layer,
+		 * others go into zlayer (y + prio) */
+		SVVector *targetArray = rowTargets[prio];
 
 		/* Check for autotile */
 		if (tileInd < 48*8)
@@ -699,8 +782,13 @@ struct TilemapPrivate
 	void clearQuadArrays()
 	{
 		groundVert.clear();
+		groundRowBases.clear();
+		zlayerSegBases.clear();
 
-		for (size_t i = 0; i < zlayersMax; ++i)
+		/* Tiles can be raised by up to 5 rows */
+		zlayerVert.resize(buildRect.h + 5);
+
+		for (size_t i = 0; i < zlayerVert.size(); ++i)
 			zlayerVert[i].clear();
 	}
 
@@ -708,10 +796,173 @@ struct TilemapPrivate
 	{
 		clearQuadArrays();
 
-		for (int x = 0; x < viewpW; ++x)
-			for (int y = 0; y < viewpH; ++y)
+		/* Rows first, so ground quads end up sorted by row,
+		 * and each zlayer by the rows contributing to it */
+		for (int y = 0; y < buildRect.h; ++y)
+		{
+			SVVector *rowTargets[6];
+			rowTargets[0] = &groundVert;
+			groundRowBases.push_back(groundVert.size() / 4);
+
+			for (int prio = 1; prio < 6; ++prio)
+			{
+				rowTargets[prio] = &zlayerVert[y + prio];
+				zlayerSegBases.push_back(zlayerVert[y + prio].size() / 4);
+			}
+
+			for (int x = 0; x < buildRect.w; ++x)
 				for (int z = 0; z < mapData->zSize(); ++z)
-					handleTile(x, y, z);
+					handleTile(x, y, z, rowTargets);
+		}
+
+		groundRowBases.push_back(groundVert.size() / 4);
+	}
+
+	/* Quad range [first, first+count) of the tiles in built
+	 * row 'y' with priority 'prio', within their target array */
+	void rowSegment(int y, int prio, size_t &first, size_t &count)
+	{
+		if (prio == 0)
+		{
+			first = groundRowBases[y];
+			count = groundRowBases[y+1] - first;
+			return;
+		}
+
+		first = zlayerSegBases[y*5 + prio-1];
+
+		/* In zlayer (y + prio), this row is followed by row
+		 * (y + 1) with priority (prio - 1), if there is one */
+		size_t end;
+
+		if (prio > 1 && y+1 < buildRect.h)
+			end = zlayerSegBases[(y+1)*5 + prio-2];
+		else
+			end = zlayerVert[y + prio].size() / 4;
+
+		count = end - first;
+	}
+
+	/* Regenerates built row 'y' and uploads it in place.
+	 * Fails if its quad count per layer changed (in which
+	 * case all buffers must be rebuilt) */
+	bool patchRow(int y)
+	{
+		SVVector rowVert[6];
+		SVVector *rowTargets[6];
+
+		for (int prio = 0; prio < 6; ++prio)
+			rowTargets[prio] = &rowVert[prio];
+
+		for (int x = 0; x < buildRect.w; ++x)
+			for (int z = 0; z < mapData->zSize(); ++z)
+				handleTile(x, y, z, rowTargets);
+
+		size_t first[6], count[6];
+
+		for (int prio = 0; prio < 6; ++prio)
+		{
+			rowSegment(y, prio, first[prio], count[prio]);
+
+			if (rowVert[prio].size() / 4 != count[prio])
+				return false;
+		}
+
+		for (int prio = 0; prio < 6; ++prio)
+		{
+			if (count[prio] == 0)
+				continue;
+
+			SVVector &target = (prio == 0) ? groundVert : zlayerVert[y + prio];
+			size_t bufferBase = (prio == 0) ? 0 : zlayerBases[y + prio];
+
+			std::copy(rowVert[prio].begin(), rowVert[prio].end(),
+			          target.begin() + first[prio] * 4);
+
+			VBO::uploadSubData(quadDataSize(bufferBase + first[prio]),
+			                   quadDataSize(count[prio]), dataPtr(rowVert[prio]));
+		}
+
+		return true;
+	}
+
+	/* Updates only the built rows affected by changed
+	 * map cells. Returns false if a full rebuild is needed */
+	bool patchBuffers()
+	{
+		const int mapW = mapData->xSize();
+		const int mapH = mapData->ySize();
+		const IntRect &dirty = dirtyCells.rect;
+
+		if (!wrappedRangeHit(buildRect.x, buildRect.w, dirty.x, dirty.w, mapW))
+			return true;
+
+		std::vector<int> rows;
+
+		for (int y = 0; y < buildRect.h; ++y)
+		{
+			int mapY = wrap(y + buildRect.y, mapH);
+
+			if (mapY >= dirty.y && mapY < dirty.y + dirty.h)
+				rows.push_back(y);
+		}
+
+		/* For large changes, a rebuild is cheaper */
+		if (rows.size() > (size_t) buildRect.h / 4)
+			return false;
+
+		VBO::bind(tiles.vbo);
+
+		bool success = true;
+
+		for (size_t i = 0; i < rows.size() && success; ++i)
+			success = patchRow(rows[i]);
+
+		VBO::unbind();
+
+		return success;
+	}
+
+	/* Number of quads the tiles in 'rect' translate to */
+	size_t countQuads(const IntRect &rect)
+	{
+		size_t count = 0;
+
+		for (int y = rect.y; y < rect.y + rect.h; ++y)
+			for (int x = rect.x; x < rect.x + rect.w; ++x)
+				for (int z = 0; z < mapData->zSize(); ++z)
+				{
+					int tileInd = tableGetWrapped(*mapData, x, y, z);
+
+					if (tileInd < 48 || samplePriority(tileInd) == -1)
+						continue;
+
+					/* Autotiles are made up of 4 pieces */
+					count += (tileInd < 48*8) ? 4 : 1;
+				}
+
+		return count;
+	}
+
+	/* Centers the build area around the map viewport,
+	 * shrinking the margin if the geometry would become
+	 * too large for the index buffer. The viewport alone
+	 * may still exceed it; see 'drawQuads()' */
+	void updateBuildRect()
+	{
+		for (int margin = buildMargin; ; margin /= 2)
+		{
+			IntRect rect(viewpPos.x - margin, viewpPos.y - margin,
+			             viewpSize.x + margin*2, viewpSize.y + margin*2);
+
+			if (margin == 0 || countQuads(rect) <= quadsMax)
+			{
+				buildRect = rect;
+				break;
+			}
+		}
+
+		updateFlashMapViewport();
 	}
 
 	static size_t quadDataSize(size_t quadCount)
@@ -730,20 +981,29 @@ struct TilemapPrivate
 		size_t groundQuadCount = groundVert.size() / 4;
 		size_t quadCount = groundQuadCount;
 
-		for (size_t i = 0; i < zlayersMax; ++i)
+		zlayerBases.resize(zlayerVert.size() + 1);
+
+		for (size_t i = 0; i < zlayerVert.size(); ++i)
 		{
 			zlayerBases[i] = quadCount;
 			quadCount += zlayerVert[i].size() / 4;
 		}
 
-		zlayerBases[zlayersMax] = quadCount;
+		zlayerBases[zlayerVert.size()] = quadCount;
 
 		VBO::bind(tiles.vbo);
-		VBO::allocEmpty(quadDataSize(quadCount));
+
+		/* Grow geometrically, so changing build
+		 * areas don't reallocate every time */
+		if (quadCount > tiles.allocQuads)
+		{
+			tiles.allocQuads = std::max(quadCount, std::min(tiles.allocQuads * 2, quadsMax));
+			VBO::allocEmpty(quadDataSize(tiles.allocQuads));
+		}
 
 		VBO::uploadSubData(0, quadDataSize(groundQuadCount), dataPtr(groundVert));
 
-		for (size_t i = 0; i < zlayersMax; ++i)
+		for (size_t i = 0; i < zlayerVert.size(); ++i)
 		{
 			if (zlayerVert[i].empty())
 				continue;
@@ -755,7 +1015,52 @@ struct TilemapPrivate
 		VBO::unbind();
 
 		/* Ensure global IBO size */
-		shState->ensureQuadIBO(quadCount);
+		shState->ensureQuadIBO(std::min(quadCount, quadsMax));
+	}
+
+	/* Points the vertex attributes at the quad 'base' */
+	void setVertexBase(size_t base)
+	{
+		const GLMeta::VAO &vao = tiles.vao;
+		const char *baseOffset = (const char*) 0 + quadDataSize(base);
+
+		VBO::bind(tiles.vbo);
+
+		for (size_t i = 0; i < vao.attrCount; ++i)
+		{
+			const VertexAttribute &va = vao.attr[i];
+			gl.VertexAttribPointer(va.index, va.size, va.type, GL_FALSE, vao.vertSize,
+			                       baseOffset + (size_t) va.offset);
+		}
+	}
+
+	/* Draws 'count' quads starting at 'first' (tile VAO bound).
+	 * The global IBO only addresses 'quadsMax' quads, so ranges
+	 * reaching past that are drawn in chunks, each with the
+	 * vertex attributes rebased to its first quad */
+	void drawQuads(size_t first, size_t count)
+	{
+		if (first + count <= quadsMax)
+		{
+			const char *offset = (const char*) 0 + first * 6 * sizeof(index_t);
+			gl.DrawElements(GL_TRIANGLES, count * 6, _GL_INDEX_TYPE, offset);
+
+			return;
+		}
+
+		while (count > 0)
+		{
+			const size_t chunk = std::min(count, quadsMax);
+
+			setVertexBase(first);
+			gl.DrawElements(GL_TRIANGLES, chunk * 6, _GL_INDEX_TYPE, 0);
+
+			first += chunk;
+			count -= chunk;
+		}
+
+		/* Native VAOs keep the rebased pointers */
+		setVertexBase(0);
 	}
 
 	void bindShader(ShaderBase *&shaderVar)
@@ -785,9 +1090,12 @@ struct TilemapPrivate
 
 	void updateActiveElements(std::vector<int> &zlayerInd)
 	{
-		elem.ground->updateVboCount();
+		elem.ground->updateVboRange(viewpPos.y - buildRect.y, viewpSize.y);
 
-		for (size_t i = 0; i < zlayersMax; ++i)
+		while (elem.zlayers.size() < zlayerInd.size())
+			elem.zlayers.push_back(new ZLayer(this, viewport));
+
+		for (size_t i = 0; i < elem.zlayers.size(); ++i)
 		{
 			if (i < zlayerInd.size())
 			{
@@ -805,11 +1113,13 @@ struct TilemapPrivate
 
 	void updateSceneElements()
 	{
-		/* Only allocate elements for non-emtpy zlayers */
+		/* Only allocate elements for non-emtpy zlayers
+		 * which are within reach of the map viewport */
 		std::vector<int> zlayerInd;
+		const size_t firstLayer = viewpPos.y - buildRect.y;
 
-		for (size_t i = 0; i < zlayersMax; ++i)
-			if (zlayerVert[i].size() > 0)
+		for (size_t i = firstLayer; i < firstLayer + zlayersMax(); ++i)
+			if (i < zlayerVert.size() && zlayerVert[i].size() > 0)
 				zlayerInd.push_back(i);
 
 		updateActiveElements(zlayerInd);
@@ -821,7 +1131,7 @@ struct TilemapPrivate
 	{
 		elem.ground->setVisible(false);
 
-		for (size_t i = 0; i < zlayersMax; ++i)
+		for (size_t i = 0; i < elem.zlayers.size(); ++i)
 			elem.zlayers[i]->setVisible(false);
 	}
 
@@ -855,14 +1165,14 @@ struct TilemapPrivate
 	 * single sized batches are possible. */
 	void prepareZLayerBatches()
 	{
-		ZLayer *const *zlayers = elem.zlayers;
+		const std::vector<ZLayer*> &zlayers = elem.zlayers;
 
 		for (size_t i = 0; i < elem.activeLayers; ++i)
 		{
 			ZLayer *batchHead = zlayers[i];
 			batchHead->batchedFlag = false;
 
-			GLsizei vboBatchCount = batchHead->vboCount;
+			size_t vboBatchCount = batchHead->vboCount;
 			IntruListLink<SceneElement> *iter = &batchHead->link;
 
 			for (i = i+1; i < elem.activeLayers; ++i)
@@ -893,8 +1203,12 @@ struct TilemapPrivate
 		if (mvpPos != viewpPos)
 		{
 			viewpPos = mvpPos;
-			buffersDirty = true;
-			updateFlashMapViewport();
+
+			/* Only rebuild once we run out of prebuilt tiles */
+			if (viewportInBuildArea())
+				layersDirty = true;
+			else
+				buffersDirty = true;
 		}
 
 		dispPos = elem.sceneGeo.rect.pos() - wrap(combOrigin, 32);
@@ -929,12 +1243,25 @@ struct TilemapPrivate
 			mapViewportDirty = false;
 		}
 
+		/* Try to patch in changed cells first */
+		if (dirtyCells.dirty && !buffersDirty)
+			buffersDirty = !patchBuffers();
+
+		dirtyCells.clear();
+
 		if (buffersDirty)
 		{
+			updateBuildRect();
 			buildQuadArray();
 			uploadBuffers();
 			updateSceneElements();
 			buffersDirty = false;
+			layersDirty = false;
+		}
+		else if (layersDirty)
+		{
+			updateSceneElements();
+			layersDirty = false;
 		}
 
 		flashMap.prepare();
@@ -953,40 +1280,46 @@ struct TilemapPrivate
 
 GroundLayer::GroundLayer(TilemapPrivate *p, Viewport *viewport)
     : ViewportElement(viewport, 0),
+      vboFirst(0),
       vboCount(0),
       p(p)
 {
 	onGeometryChange(scene->getGeometry());
 }
 
-void GroundLayer::updateVboCount()
+void GroundLayer::updateVboRange(int firstRow, int rowCount)
 {
-	vboCount = p->zlayerBases[0] * 6;
+	const std::vector<size_t> &rowBases = p->groundRowBases;
+
+	vboFirst = rowBases[firstRow];
+	vboCount = rowBases[firstRow+rowCount] - rowBases[firstRow];
 }
 
 void GroundLayer::draw()
 {
-	if (p->groundVert.size() == 0)
-		return;
+	const Vec2i offset = p->buildOffset();
 
-	ShaderBase *shader;
+	if (vboCount > 0)
+	{
+		ShaderBase *shader;
 
-	p->bindShader(shader);
-	p->bindAtlas(*shader);
+		p->bindShader(shader);
+		p->bindAtlas(*shader);
 
-	GLMeta::vaoBind(p->tiles.vao);
+		GLMeta::vaoBind(p->tiles.vao);
 
-	shader->setTranslation(p->dispPos);
-	drawInt();
+		shader->setTranslation(offset);
+		drawInt();
 
-	GLMeta::vaoUnbind(p->tiles.vao);
+		GLMeta::vaoUnbind(p->tiles.vao);
+	}
 
-	p->flashMap.draw(flashAlpha[p->flashAlphaIdx] / 255.f, p->dispPos);
+	p->flashMap.draw(flashAlpha[p->flashAlphaIdx] / 255.f, offset);
 }
 
 void GroundLayer::drawInt()
 {
-	gl.DrawElements(GL_TRIANGLES, vboCount, _GL_INDEX_TYPE, (GLvoid*) 0);
+	p->drawQuads(vboFirst, vboCount);
 }
 
 void GroundLayer::onGeometryChange(const Scene::Geometry &geo)
@@ -997,7 +1330,7 @@ void GroundLayer::onGeometryChange(const Scene::Geometry &geo)
 ZLayer::ZLayer(TilemapPrivate *p, Viewport *viewport)
     : ViewportElement(viewport, 0),
       index(0),
-      vboOffset(0),
+      vboFirst(0),
       vboCount(0),
       p(p),
       vboBatchCount(0)
@@ -1010,8 +1343,8 @@ void ZLayer::setIndex(int value)
 	z = calculateZ(p, index);
 	scene->reinsert(*this);
 
-	vboOffset = p->zlayerBases[index] * sizeof(index_t) * 6;
-	vboCount = p->zlayerSize(index) * 6;
+	vboFirst = p->zlayerBases[index];
+	vboCount = p->zlayerSize(index);
 }
 
 void ZLayer::draw()
@@ -1026,7 +1359,7 @@ void ZLayer::draw()
 
 	GLMeta::vaoBind(p->tiles.vao);
 
-	shader->setTranslation(p->dispPos);
+	shader->setTranslation(p->buildOffset());
 	drawInt();
 
 	GLMeta::vaoUnbind(p->tiles.vao);
@@ -1034,12 +1367,12 @@ void ZLayer::draw()
 
 void ZLayer::drawInt()
 {
-	gl.DrawElements(GL_TRIANGLES, vboBatchCount, _GL_INDEX_TYPE, (GLvoid*) vboOffset);
+	p->drawQuads(vboFirst, vboBatchCount);
 }
 
 int ZLayer::calculateZ(TilemapPrivate *p, int index)
 {
-	return 32 * (index + p->viewpPos.y + 1) - p->origin.y;
+	return 32 * (index + p->buildRect.y + 1) - p->origin.y;
 }
 
 void ZLayer::initUpdateZ()
@@ -1177,7 +1510,7 @@ void Tilemap::setMapData(Table *value)
 	p->invalidateBuffers();
 	p->mapDataCon.disconnect();
 	p->mapDataCon = value->modified.connect
-	        (sigc::mem_fun(p, &TilemapPrivate::invalidateBuffers));
+	        (sigc::mem_fun(p, &TilemapPrivate::onMapDataModified));
 }
 
 void Tilemap::setFlashData(Table *value)
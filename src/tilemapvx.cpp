@@ -68,6 +68,30 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 	std::vector<SVertex> groundVert;
 	std::vector<SVertex> aboveVert;
 
+	/* Quad ranges each row of each pass was read into,
+	 * ie. [pass * mapViewp.h + row] */
+	struct RowSegment
+	{
+		size_t groundFirst, groundCount;
+		size_t aboveFirst, aboveCount;
+	};
+
+	std::vector<RowSegment> rowSegments;
+	RowSegment *curSegment;
+
+	/* Collects the quads of a single row for patching */
+	struct RowReader : public TileAtlasVX::Reader
+	{
+		std::vector<SVertex> ground;
+		std::vector<SVertex> above;
+
+		void onQuads(const FloatRect *t, const FloatRect *p,
+		             size_t n, bool overPlayer)
+		{
+			addQuads(overPlayer ? above : ground, t, p, n);
+		}
+	};
+
 	TEXFBO atlas;
 	VBO::ID vbo;
 	GLMeta::VAO vao;
@@ -87,6 +111,9 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 	bool buffersDirty;
 	bool mapViewportDirty;
 
+	/* Cells of mapData changed since the last update */
+	TableDirtyRect dirtyCells;
+
 	sigc::connection mapDataCon;
 	sigc::connection flagsCon;
 
@@ -109,6 +136,11 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 			p->drawFlashLayer();
 		}
 
+		GpuTimer::Category gpuCategory() const
+		{
+			return GpuTimer::Tilemaps;
+		}
+
 		ABOUT_TO_ACCESS_NOOP
 	};
 
@@ -118,6 +150,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 	    : ViewportElement(viewport),
 	      mapData(0),
 	      flags(0),
+	      curSegment(0),
 	      allocQuads(0),
 	      groundQuads(0),
 	      aboveQuads(0),
@@ -174,6 +207,11 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		buffersDirty = true;
 	}
 
+	void onMapDataModified()
+	{
+		dirtyCells.add(mapData->modifiedRegion());
+	}
+
 	void rebuildAtlas()
 	{
 		TileAtlasVX::build(atlas, bitmaps);
@@ -211,6 +249,17 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		return quads * 4 * sizeof(SVertex);
 	}
 
+	/* Ends the row segment currently being read */
+	void closeSegment()
+	{
+		if (!curSegment)
+			return;
+
+		curSegment->groundCount = groundVert.size() / 4 - curSegment->groundFirst;
+		curSegment->aboveCount = aboveVert.size() / 4 - curSegment->aboveFirst;
+		curSegment = 0;
+	}
+
 	void rebuildBuffers()
 	{
 		if (!mapData)
@@ -219,9 +268,14 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		groundVert.clear();
 		aboveVert.clear();
 
+		rowSegments.assign(TileAtlasVX::PASS_COUNT * mapViewp.h, RowSegment());
+		curSegment = 0;
+
 		TileAtlasVX::readTiles(*this, *mapData, flags,
 		                       mapViewp.x, mapViewp.y, mapViewp.w, mapViewp.h);
 
+		closeSegment();
+
 		groundQuads = groundVert.size() / 4;
 		aboveQuads = aboveVert.size() / 4;
 		size_t totalQuads = groundQuads + aboveQuads;
@@ -242,6 +296,82 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		shState->ensureQuadIBO(totalQuads);
 	}
 
+	/* Reads map viewport row 'y' again and uploads it in place.
+	 * Fails if its quad count in any pass changed (in which
+	 * case all buffers must be rebuilt) */
+	bool patchRow(int y)
+	{
+		RowReader rows[TileAtlasVX::PASS_COUNT];
+		const RowSegment *segs = &rowSegments[y];
+
+		for (int pass = 0; pass < TileAtlasVX::PASS_COUNT; ++pass)
+		{
+			TileAtlasVX::readRow(rows[pass], *mapData, flags,
+			                     mapViewp.x, mapViewp.y, mapViewp.w, y, pass);
+
+			const RowSegment &seg = segs[pass * mapViewp.h];
+
+			if (rows[pass].ground.size() / 4 != seg.groundCount ||
+			    rows[pass].above.size() / 4 != seg.aboveCount)
+				return false;
+		}
+
+		for (int pass = 0; pass < TileAtlasVX::PASS_COUNT; ++pass)
+		{
+			const RowSegment &seg = segs[pass * mapViewp.h];
+
+			if (seg.groundCount > 0)
+				VBO::uploadSubData(quadBytes(seg.groundFirst), quadBytes(seg.groundCount),
+				                   dataPtr(rows[pass].ground));
+
+			if (seg.aboveCount > 0)
+				VBO::uploadSubData(quadBytes(groundQuads + seg.aboveFirst),
+				                   quadBytes(seg.aboveCount), dataPtr(rows[pass].above));
+		}
+
+		return true;
+	}
+
+	/* Updates only the map viewport rows affected by changed
+	 * map cells. Returns false if a full rebuild is needed */
+	bool patchBuffers()
+	{
+		const int mapW = mapData->xSize();
+		const int mapH = mapData->ySize();
+		const IntRect &dirty = dirtyCells.rect;
+
+		if (rowSegments.size() != (size_t) TileAtlasVX::PASS_COUNT * mapViewp.h)
+			return false;
+
+		if (!wrappedRangeHit(mapViewp.x, mapViewp.w, dirty.x, dirty.w, mapW))
+			return true;
+
+		std::vector<int> rows;
+
+		for (int y = 0; y < mapViewp.h; ++y)
+		{
+			int mapY = wrap(y + mapViewp.y, mapH);
+
+			if (mapY >= dirty.y && mapY < dirty.y + dirty.h)
+				rows.push_back(y);
+		}
+
+		/* For large changes, a rebuild is cheaper */
+		if (rows.size() > (size_t) mapViewp.h / 4)
+			return false;
+
+		VBO::bind(vbo);
+
+		bool success = true;
+
+		for (size_t i = 0; i < rows.size() && success; ++i)
+			success = patchRow(rows[i]);
+
+		VBO::unbind();
+
+		return success;
+	}
+
 	void prepare()
 	{
 		if (!mapData)
@@ -259,6 +389,12 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 			mapViewportDirty = false;
 		}
 
+		/* Try to patch in changed cells first */
+		if (dirtyCells.dirty && !buffersDirty)
+			buffersDirty = !patchBuffers();
+
+		dirtyCells.clear();
+
 		if (buffersDirty)
 		{
 			rebuildBuffers();
@@ -268,12 +404,14 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		flashMap.prepare();
 	}
 
-	SVertex *allocVert(std::vector<SVertex> &vec, size_t count)
+	static void addQuads(std::vector<SVertex> &vec, const FloatRect *t,
+	                     const FloatRect *p, size_t n)
 	{
 		size_t size = vec.size();
-		vec.resize(size + count);
+		vec.resize(size + n*4);
 
-		return &vec[size];
+		for (size_t i = 0; i < n; ++i)
+			Quad::setTexPosRect(&vec[size + i*4], t[i], p[i]);
 	}
 
 	/* SceneElement */
@@ -283,6 +421,11 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		drawFlashLayer();
 	}
 
+	GpuTimer::Category gpuCategory() const
+	{
+		return GpuTimer::Tilemaps;
+	}
+
 	void drawGround()
 	{
 		if (groundQuads == 0)
@@ -360,10 +503,16 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 	void onQuads(const FloatRect *t, const FloatRect *p,
 	             size_t n, bool overPlayer)
 	{
-		SVertex *vert = allocVert(overPlayer ? aboveVert : groundVert, n*4);
+		addQuads(overPlayer ? aboveVert : groundVert, t, p, n);
+	}
+
+	void onRow(int pass, int y)
+	{
+		closeSegment();
 
-		for (size_t i = 0; i < n; ++i)
-			Quad::setTexPosRect(&vert[i*4], t[i], p[i]);
+		curSegment = &rowSegments[pass * mapViewp.h + y];
+		curSegment->groundFirst = groundVert.size() / 4;
+		curSegment->aboveFirst = aboveVert.size() / 4;
 	}
 };
 
@@ -482,7 +631,7 @@ void TilemapVX::setMapData(Table *value)
 
 	p->mapDataCon.disconnect();
 	p->mapDataCon = value->modified.connect
-		(sigc::mem_fun(p, &TilemapVXPrivate::invalidateBuffers));
+		(sigc::mem_fun(p, &TilemapVXPrivate::onMapDataModified));
 }
 
 void TilemapVX::setFlashData(Table *value)
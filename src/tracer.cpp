@@ -0,0 +1,252 @@
+/*
+** tracer.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tracer.h"
+
+#include "sdl-util.h"
+#include "debugwriter.h"
+
+#include <SDL_atomic.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+/* Events kept per thread. Must be a power of two, so
+ * ring positions survive the event counter wrapping */
+static const unsigned bufferSize = 16384;
+
+/* Buffers of finished threads are kept (so their events
+ * still show up in the trace) until there are this many */
+static const size_t retiredMax = 8;
+
+struct TraceEvent
+{
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+};
+
+struct ThreadBuffer
+{
+	SDL_threadID tid;
+	std::string name;
+
+	TraceEvent events[bufferSize];
+
+	/* Total events recorded so far (modulo 2^32,
+	 * read as unsigned); only written by the owning
+	 * thread */
+	SDL_atomic_t written;
+
+	/* Set once 'events' has been filled up */
+	bool full;
+
+	bool retired;
+
+	void reset()
+	{
+		tid = SDL_ThreadID();
+		name.clear();
+		SDL_AtomicSet(&written, 0);
+		full = false;
+		retired = false;
+	}
+};
+
+namespace Tracer
+{
+	bool enabled = false;
+}
+
+static SDL_TLSID bufferTLS;
+static uint64_t baseTicks;
+
+/* Guards 'buffers' and the buffers' non-event members */
+static SDL_mutex *buffersMutex;
+static std::vector<ThreadBuffer*> buffers;
+
+static void retireBuffer(void *data)
+{
+	ThreadBuffer *buf = static_cast<ThreadBuffer*>(data);
+
+	SDL_LockMutex(buffersMutex);
+	buf->retired = true;
+	SDL_UnlockMutex(buffersMutex);
+}
+
+static ThreadBuffer *getThreadBuffer()
+{
+	ThreadBuffer *buf = static_cast<ThreadBuffer*>(SDL_TLSGet(bufferTLS));
+
+	if (buf)
+		return buf;
+
+	SDL_LockMutex(buffersMutex);
+
+	/* Reuse the oldest retired buffer once enough piled up */
+	size_t retired = 0;
+	for (size_t i = 0; i < buffers.size(); ++i)
+		if (buffers[i]->retired)
+			++retired;
+
+	if (retired >= retiredMax)
+	{
+		for (size_t i = 0; i < buffers.size(); ++i)
+		{
+			if (!buffers[i]->retired)
+				continue;
+
+			buf = buffers[i];
+			buffers.erase(buffers.begin() + i);
+			break;
+		}
+	}
+	else
+	{
+		buf = new ThreadBuffer;
+	}
+
+	buf->reset();
+	buffers.push_back(buf);
+
+	SDL_UnlockMutex(buffersMutex);
+
+	SDL_TLSSet(bufferTLS, buf, retireBuffer);
+
+	return buf;
+}
+
+void Tracer::init(bool enabled)
+{
+	Tracer::enabled = enabled;
+
+	if (!enabled)
+		return;
+
+	bufferTLS = SDL_TLSCreate();
+	baseTicks = SDL_GetPerformanceCounter();
+	buffersMutex = SDL_CreateMutex();
+}
+
+void Tracer::setThreadName(const char *name)
+{
+	if (!enabled)
+		return;
+
+	ThreadBuffer *buf = getThreadBuffer();
+
+	SDL_LockMutex(buffersMutex);
+	buf->name = name;
+	SDL_UnlockMutex(buffersMutex);
+}
+
+void Tracer::record(const char *name, uint64_t start, uint64_t end)
+{
+	ThreadBuffer *buf = getThreadBuffer();
+
+	unsigned index = SDL_AtomicGet(&buf->written);
+
+	TraceEvent &event = buf->events[index % bufferSize];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+
+	if (index + 1 == bufferSize)
+		buf->full = true;
+
+	/* Publishes the event to 'dump()'; the barrier keeps
+	 * weakly ordered CPUs from making the counter visible
+	 * before the event data */
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&buf->written, (int) (index + 1));
+}
+
+bool Tracer::dump(const char *filename)
+{
+	if (!enabled)
+		return false;
+
+	const double usPerTick = 1000000.0 / SDL_GetPerformanceFrequency();
+
+	std::string out = "{\"traceEvents\":[\n";
+	char line[256];
+	bool first = true;
+
+	SDL_LockMutex(buffersMutex);
+
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		ThreadBuffer *buf = buffers[i];
+		const unsigned long tid = buf->tid;
+
+		if (!buf->name.empty())
+		{
+			snprintf(line, sizeof(line),
+			         "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,"
+			         "\"args\":{\"name\":\"%s\"}}",
+			         first ? "" : ",\n", tid, buf->name.c_str());
+			out += line;
+			first = false;
+		}
+
+		/* Events older than one buffer length have been
+		 * overwritten. The owning thread may still be
+		 * recording, so the oldest few can be torn */
+		const unsigned written = SDL_AtomicGet(&buf->written);
+		SDL_MemoryBarrierAcquire();
+
+		const unsigned count = buf->full ? bufferSize : written;
+
+		for (unsigned j = written - count; j != written; ++j)
+		{
+			const TraceEvent &event = buf->events[j % bufferSize];
+
+			snprintf(line, sizeof(line),
+			         "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,"
+			         "\"ts\":%.3f,\"dur\":%.3f}",
+			         first ? "" : ",\n", event.name, tid,
+			         (event.start - baseTicks) * usPerTick,
+			         (event.end - event.start) * usPerTick);
+			out += line;
+			first = false;
+		}
+	}
+
+	SDL_UnlockMutex(buffersMutex);
+
+	out += "\n]}\n";
+
+	SDL_RWops *ops = RWFromFile(filename, "wb");
+
+	if (!ops)
+	{
+		Debug() << "Failed to write trace to" << filename << ":" << SDL_GetError();
+		return false;
+	}
+
+	size_t writ = SDL_RWwrite(ops, out.c_str(), 1, out.size());
+	SDL_RWclose(ops);
+
+	return writ == out.size();
+}
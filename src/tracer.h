@@ -0,0 +1,81 @@
+/*
+** tracer.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 Jonas Kulla <Nyocurio@gmail.com>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <SDL_timer.h>
+
+#include <stdint.h>
+
+/* Records timed scopes from any thread and writes them out
+ * in the Chrome trace event format (load the file in
+ * chrome://tracing or ui.perfetto.dev).
+ *
+ * Every thread records into its own ring buffer, so no locking
+ * happens while tracing; only the most recent events of each
+ * thread are kept. When disabled, a scope costs one branch */
+namespace Tracer
+{
+	/* Must be called before any other thread is started */
+	void init(bool enabled);
+
+	extern bool enabled;
+
+	inline bool isEnabled()
+	{
+		return enabled;
+	}
+
+	/* Shown for the calling thread in the trace */
+	void setThreadName(const char *name);
+
+	/* 'name' must be a string literal */
+	void record(const char *name, uint64_t start, uint64_t end);
+
+	/* Writes all recorded events to 'filename' */
+	bool dump(const char *filename);
+}
+
+struct TraceScope
+{
+	const char *name;
+	uint64_t start;
+
+	TraceScope(const char *name)
+	    : name(name),
+	      start(Tracer::isEnabled() ? SDL_GetPerformanceCounter() : 0)
+	{}
+
+	~TraceScope()
+	{
+		if (start)
+			Tracer::record(name, start, SDL_GetPerformanceCounter());
+	}
+};
+
+#define TRACE_SCOPE_CAT(a, b) a##b
+#define TRACE_SCOPE_VAR(line) TRACE_SCOPE_CAT(_traceScope, line)
+
+#define TRACE_SCOPE(name) \
+	TraceScope TRACE_SCOPE_VAR(__LINE__)(name)
+
+#endif // TRACER_H
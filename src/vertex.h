@@ -51,6 +51,16 @@ struct Vertex
 	Vertex();
 };
 
+/* Batched sprite vertex */
+struct BVertex
+{
+	Vec2 pos;
+	Vec2 texPos;
+	Vec4 color;
+	Vec4 tone;
+	float opacity;
+};
+
 struct VertexAttribute
 {
 	Shader::Attribute index;
@@ -223,6 +223,11 @@ struct WindowPrivate
 			p->drawControls();
 		}
 
+		GpuTimer::Category gpuCategory() const
+		{
+			return GpuTimer::Windows;
+		}
+
 		void release()
 		{
 			unlink();
@@ -717,6 +722,10 @@ void Window::setWindowskin(Bitmap *value)
 		return;
 
 	value->ensureNonMega();
+
+	/* Smooth sampling would bleed into the
+	 * neighbouring entries of an atlas page */
+	value->ensureNonAtlas();
 }
 
 void Window::setContents(Bitmap *value)
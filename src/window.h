@@ -62,6 +62,7 @@ private:
 	WindowPrivate *p;
 
 	void draw();
+	GpuTimer::Category gpuCategory() const { return GpuTimer::Windows; }
 	void onGeometryChange(const Scene::Geometry &);
 	void setZ(int value);
 	void setVisible(bool value);
@@ -914,6 +914,11 @@ void WindowVX::setWindowskin(Bitmap *value)
 
 	p->windowskin = value;
 	p->base.texDirty = true;
+
+	/* Smooth sampling would bleed into the
+	 * neighbouring entries of an atlas page */
+	if (!nullOrDisposed(value))
+		value->ensureNonAtlas();
 }
 
 void WindowVX::setContents(Bitmap *value)
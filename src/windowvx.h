@@ -72,6 +72,7 @@ private:
 	WindowVXPrivate *p;
 
 	void draw();
+	GpuTimer::Category gpuCategory() const { return GpuTimer::Windows; }
 	void onGeometryChange(const Scene::Geometry &);
 
 	void releaseResources();